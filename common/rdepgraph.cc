@@ -0,0 +1,358 @@
+/* rdepgraph.cc - the dependencies of all packages, for transitive queries
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include <algorithm>
+
+#include <apt-pkg/depcache.h>
+
+#include "config.h"
+#include "rdepgraph.h"
+
+void RDependencyGraph::clear()
+{
+   _offsets.clear();
+   _groupStarts.clear();
+   _groupTypes.clear();
+   _groupOwners.clear();
+   _targets.clear();
+   _rOffsets.clear();
+   _rGroups.clear();
+   _installed.clear();
+   _seen.clear();
+   _parent.clear();
+   _parentType.clear();
+   _queue.clear();
+   _mark = 0;
+   _built = false;
+}
+
+static uint8_t edgeType(unsigned char depType)
+{
+   switch (depType) {
+   case pkgCache::Dep::Depends:
+      return RDependencyGraph::Depends;
+   case pkgCache::Dep::PreDepends:
+      return RDependencyGraph::PreDepends;
+   case pkgCache::Dep::Recommends:
+      return RDependencyGraph::Recommends;
+   }
+   return 0;
+}
+
+void RDependencyGraph::edges(pkgCache::PkgIterator &pkg,
+                             unsigned int &groups, unsigned int &members,
+                             uint32_t *groupStarts, uint8_t *groupTypes,
+                             uint32_t *targets, uint32_t targetBase)
+{
+   groups = members = 0;
+   pkgCache::VerIterator ver = pkg.CurrentVer();
+   if (ver.end())
+      ver = pkg.VersionList();
+   if (ver.end())
+      return;
+
+   // the alternatives of an or group follow each other, all but the
+   // last have the Or flag
+   bool inGroup = false;
+   bool skip = false;
+   for (pkgCache::DepIterator D = ver.DependsList(); !D.end(); D++) {
+      bool first = !inGroup;
+      inGroup = (D->CompareOp & pkgCache::Dep::Or) != 0;
+      if (first) {
+         uint8_t type = edgeType(D->Type);
+         skip = type == 0;
+         if (skip)
+            continue;
+         if (groupStarts != NULL) {
+            groupStarts[groups] = targetBase + members;
+            groupTypes[groups] = type;
+         }
+         groups++;
+      } else if (skip) {
+         continue;
+      }
+
+      pkgCache::PkgIterator Trg = D.TargetPkg();
+      if (Trg->VersionList != 0) {
+         if (targets != NULL)
+            targets[members] = Trg->ID;
+         members++;
+         continue;
+      }
+      for (pkgCache::PrvIterator P = Trg.ProvidesList(); !P.end(); P++) {
+         if (targets != NULL)
+            targets[members] = P.OwnerPkg()->ID;
+         members++;
+      }
+   }
+}
+
+void RDependencyGraph::build(pkgDepCache *deps)
+{
+   clear();
+
+   unsigned int count = deps->Head().PackageCount;
+   _installed.assign(count, false);
+   _offsets.assign(count + 1, 0);
+   _rOffsets.assign(count + 1, 0);
+
+   // the cache is not in id order, so the groups and their members
+   // are counted first and then put where their package starts
+   vector<uint32_t> memberOffsets(count + 1, 0);
+   for (pkgCache::PkgIterator P = deps->PkgBegin(); !P.end(); P++) {
+      unsigned int groups, members;
+      edges(P, groups, members, NULL, NULL, NULL, 0);
+      _offsets[P->ID + 1] = groups;
+      memberOffsets[P->ID + 1] = members;
+      _installed[P->ID] = !P.CurrentVer().end();
+   }
+   for (unsigned int i = 0; i < count; i++) {
+      _offsets[i + 1] += _offsets[i];
+      memberOffsets[i + 1] += memberOffsets[i];
+   }
+
+   unsigned int groupCount = _offsets[count];
+   _groupStarts.resize(groupCount + 1);
+   _groupTypes.resize(groupCount);
+   _groupOwners.resize(groupCount);
+   _targets.resize(memberOffsets[count]);
+   _groupStarts[groupCount] = _targets.size();
+   for (pkgCache::PkgIterator P = deps->PkgBegin(); !P.end(); P++) {
+      uint32_t first = _offsets[P->ID];
+      if (_offsets[P->ID + 1] == first)
+         continue;
+      unsigned int groups, members;
+      uint32_t base = memberOffsets[P->ID];
+      edges(P, groups, members, &_groupStarts[first], &_groupTypes[first],
+            _targets.empty() ? NULL : &_targets[0] + base, base);
+      for (uint32_t g = first; g < first + groups; g++)
+         _groupOwners[g] = P->ID;
+   }
+
+   buildReverse();
+}
+
+void RDependencyGraph::build(unsigned int count, const vector<bool> &installed,
+                             const vector<Group> &groups)
+{
+   clear();
+
+   _installed = installed;
+   _installed.resize(count, false);
+   _offsets.assign(count + 1, 0);
+   _rOffsets.assign(count + 1, 0);
+   for (unsigned int i = 0; i < groups.size(); i++)
+      _offsets[groups[i].owner + 1]++;
+   for (unsigned int i = 0; i < count; i++)
+      _offsets[i + 1] += _offsets[i];
+
+   unsigned int groupCount = groups.size();
+   _groupStarts.resize(groupCount + 1);
+   _groupTypes.resize(groupCount);
+   _groupOwners.resize(groupCount);
+   vector<uint32_t> next(_offsets.begin(), _offsets.end() - 1);
+   vector<uint32_t> order(groupCount);
+   for (unsigned int i = 0; i < groupCount; i++)
+      order[next[groups[i].owner]++] = i;
+   for (uint32_t g = 0; g < groupCount; g++) {
+      const Group &group = groups[order[g]];
+      _groupStarts[g] = _targets.size();
+      _groupTypes[g] = group.type;
+      _groupOwners[g] = group.owner;
+      _targets.insert(_targets.end(), group.members.begin(),
+                      group.members.end());
+   }
+   _groupStarts[groupCount] = _targets.size();
+
+   buildReverse();
+}
+
+void RDependencyGraph::buildReverse()
+{
+   unsigned int count = size();
+   unsigned int groupCount = _groupTypes.size();
+
+   // the groups each package is a member of follow from the others
+   for (unsigned int e = 0; e < _targets.size(); e++)
+      _rOffsets[_targets[e] + 1]++;
+   for (unsigned int i = 0; i < count; i++)
+      _rOffsets[i + 1] += _rOffsets[i];
+
+   _rGroups.resize(_targets.size());
+   vector<uint32_t> next(_rOffsets.begin(), _rOffsets.end() - 1);
+   for (uint32_t g = 0; g < groupCount; g++) {
+      for (uint32_t e = _groupStarts[g]; e < _groupStarts[g + 1]; e++)
+         _rGroups[next[_targets[e]]++] = g;
+   }
+
+   _built = true;
+}
+
+void RDependencyGraph::startSearch()
+{
+   if (_seen.size() != size()) {
+      _seen.assign(size(), 0);
+      _parent.resize(size());
+      _parentType.resize(size());
+      _mark = 0;
+   }
+   if (++_mark == 0) {
+      fill(_seen.begin(), _seen.end(), 0);
+      _mark = 1;
+   }
+   _queue.clear();
+}
+
+void RDependencyGraph::search(const vector<uint32_t> &start, bool reverse,
+                              unsigned int types, bool installedOnly,
+                              vector<uint32_t> &result)
+{
+   result.clear();
+   if (!_built)
+      return;
+   startSearch();
+
+   for (unsigned int i = 0; i < start.size(); i++) {
+      uint32_t id = start[i];
+      if (id < size() && _seen[id] != _mark) {
+         _seen[id] = _mark;
+         _queue.push_back(id);
+      }
+   }
+
+   // breadth first, so the nearer packages come first in result
+   for (unsigned int head = 0; head < _queue.size(); head++) {
+      uint32_t id = _queue[head];
+      if (reverse) {
+         for (uint32_t r = _rOffsets[id]; r < _rOffsets[id + 1]; r++) {
+            uint32_t g = _rGroups[r];
+            uint32_t next = _groupOwners[g];
+            if (!(_groupTypes[g] & types) || _seen[next] == _mark)
+               continue;
+            if (installedOnly && !_installed[next])
+               continue;
+            _seen[next] = _mark;
+            _queue.push_back(next);
+            result.push_back(next);
+         }
+         continue;
+      }
+      for (uint32_t g = _offsets[id]; g < _offsets[id + 1]; g++) {
+         if (!(_groupTypes[g] & types))
+            continue;
+         for (uint32_t e = _groupStarts[g]; e < _groupStarts[g + 1]; e++) {
+            uint32_t next = _targets[e];
+            if (_seen[next] == _mark)
+               continue;
+            if (installedOnly && !_installed[next])
+               continue;
+            _seen[next] = _mark;
+            _queue.push_back(next);
+            result.push_back(next);
+         }
+      }
+   }
+}
+
+bool RDependencyGraph::satisfied(uint32_t g)
+{
+   for (uint32_t e = _groupStarts[g]; e < _groupStarts[g + 1]; e++) {
+      uint32_t id = _targets[e];
+      if (_installed[id] && _seen[id] != _mark)
+         return true;
+   }
+   return false;
+}
+
+void RDependencyGraph::removalClosure(const vector<uint32_t> &ids,
+                                      unsigned int types,
+                                      vector<uint32_t> &result)
+{
+   result.clear();
+   if (!_built)
+      return;
+   startSearch();
+
+   // marked are the packages that go
+   for (unsigned int i = 0; i < ids.size(); i++) {
+      uint32_t id = ids[i];
+      if (id < size() && _seen[id] != _mark) {
+         _seen[id] = _mark;
+         _queue.push_back(id);
+      }
+   }
+
+   // what goes only grows, so a group that lost its last installed
+   // member when one of them was taken stays without one
+   for (unsigned int head = 0; head < _queue.size(); head++) {
+      uint32_t id = _queue[head];
+      for (uint32_t r = _rOffsets[id]; r < _rOffsets[id + 1]; r++) {
+         uint32_t g = _rGroups[r];
+         uint32_t owner = _groupOwners[g];
+         if (!(_groupTypes[g] & types) || _seen[owner] == _mark ||
+             !_installed[owner] || satisfied(g))
+            continue;
+         _seen[owner] = _mark;
+         _queue.push_back(owner);
+         result.push_back(owner);
+      }
+   }
+}
+
+bool RDependencyGraph::shortestPath(const vector<bool> &from, uint32_t id,
+                                    unsigned int types, bool installedOnly,
+                                    vector<uint32_t> &path,
+                                    vector<uint8_t> &edgeTypes)
+{
+   path.clear();
+   edgeTypes.clear();
+   if (!_built || id >= size())
+      return false;
+   startSearch();
+
+   // backwards from id until a package of from turns up, then along
+   // the parents forward again
+   _seen[id] = _mark;
+   _queue.push_back(id);
+   for (unsigned int head = 0; head < _queue.size(); head++) {
+      uint32_t cur = _queue[head];
+      if (cur < from.size() && from[cur]) {
+         for (; cur != id; cur = _parent[cur]) {
+            path.push_back(cur);
+            edgeTypes.push_back(_parentType[cur]);
+         }
+         path.push_back(id);
+         return true;
+      }
+      for (uint32_t r = _rOffsets[cur]; r < _rOffsets[cur + 1]; r++) {
+         uint32_t g = _rGroups[r];
+         uint32_t next = _groupOwners[g];
+         if (!(_groupTypes[g] & types) || _seen[next] == _mark)
+            continue;
+         if (installedOnly && !_installed[next])
+            continue;
+         _seen[next] = _mark;
+         _parent[next] = cur;
+         _parentType[next] = _groupTypes[g];
+         _queue.push_back(next);
+      }
+   }
+   return false;
+}
+
+// vim:ts=3:sw=3:et
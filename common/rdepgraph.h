@@ -0,0 +1,145 @@
+/* rdepgraph.h - the dependencies of all packages, for transitive queries
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RDEPGRAPH_H
+#define RDEPGRAPH_H
+
+#include <vector>
+#include <stdint.h>
+
+#include <apt-pkg/pkgcache.h>
+
+using namespace std;
+
+class pkgDepCache;
+
+// The Depends, PreDepends and Recommends of every package of the cache
+// by package id, in both directions, packed in a few arrays so that
+// the searches below only walk memory. A package is looked at in its
+// installed version, or in its newest one if it is not installed, so
+// the graph only changes when the cache is opened again.
+//
+// A dependency is kept as a group of the packages that can satisfy
+// it: the alternatives of an or group, with virtual packages replaced
+// by their providers. Pulling in follows every member of a group, a
+// removal only cascades over a group when none of its installed
+// members is left.
+//
+// The searches share their scratch space, use them from one thread.
+class RDependencyGraph {
+ public:
+   enum EdgeType {
+      Depends = 1 << 0,
+      PreDepends = 1 << 1,
+      Recommends = 1 << 2,
+      Hard = Depends | PreDepends,
+      All = Depends | PreDepends | Recommends
+   };
+
+ protected:
+   // the groups of package id i go from _offsets[i] to _offsets[i + 1],
+   // the members of group g from _groupStarts[g] to _groupStarts[g + 1]
+   // in _targets
+   vector<uint32_t> _offsets;
+   vector<uint32_t> _groupStarts;
+   vector<uint8_t> _groupTypes;
+   vector<uint32_t> _groupOwners;
+   vector<uint32_t> _targets;
+   // the groups package id i is a member of, from _rOffsets[i] to
+   // _rOffsets[i + 1] in _rGroups
+   vector<uint32_t> _rOffsets;
+   vector<uint32_t> _rGroups;
+   vector<bool> _installed;
+   bool _built;
+
+   // visited when _seen[id] == _mark, so nothing is cleared between
+   // searches
+   vector<uint32_t> _seen;
+   uint32_t _mark;
+   vector<uint32_t> _queue;
+   vector<uint32_t> _parent;
+   vector<uint8_t> _parentType;
+
+   // the groups and members of one package, only counted without
+   // groupStarts; the members are stored from targetBase on
+   void edges(pkgCache::PkgIterator &pkg, unsigned int &groups,
+              unsigned int &members, uint32_t *groupStarts,
+              uint8_t *groupTypes, uint32_t *targets, uint32_t targetBase);
+   void startSearch();
+   void search(const vector<uint32_t> &start, bool reverse,
+               unsigned int types, bool installedOnly,
+               vector<uint32_t> &result);
+   // an installed member of group g that is not marked
+   bool satisfied(uint32_t g);
+   // the rest of build() once the groups are there
+   void buildReverse();
+
+ public:
+   // a dependency of owner, satisfied by any of members; to build a
+   // graph that does not come from a cache
+   struct Group {
+      uint32_t owner;
+      uint8_t type;
+      vector<uint32_t> members;
+   };
+
+   void build(pkgDepCache *deps);
+   // groups in any order, the ids below count
+   void build(unsigned int count, const vector<bool> &installed,
+              const vector<Group> &groups);
+   void clear();
+
+   bool built() const { return _built; }
+   unsigned int size() const { return _installed.size(); }
+   unsigned int edgeCount() const { return _targets.size(); }
+   bool isInstalled(uint32_t id) const {
+      return id < _installed.size() && _installed[id];
+   }
+
+   // everything the packages pull in, through every member of the
+   // groups of the given types, never the packages themselves, not
+   // even when there is a loop back to them; with installedOnly the
+   // search does not go through packages that are not installed
+   void closure(const vector<uint32_t> &ids, unsigned int types,
+                bool installedOnly, vector<uint32_t> &result) {
+      search(ids, false, types, installedOnly, result);
+   }
+   // everything that pulls the packages in
+   void reverseClosure(const vector<uint32_t> &ids, unsigned int types,
+                       bool installedOnly, vector<uint32_t> &result) {
+      search(ids, true, types, installedOnly, result);
+   }
+   // the installed packages that lose a dependency of the given types
+   // when the packages go, as no other installed member of its group
+   // is left, and so on
+   void removalClosure(const vector<uint32_t> &ids, unsigned int types,
+                       vector<uint32_t> &result);
+
+   // one of the shortest chains of dependencies from a package in from
+   // (by id) to id, starting with that package; edgeTypes[i] is the type
+   // of the edge from path[i] to path[i + 1]. False if there is none.
+   bool shortestPath(const vector<bool> &from, uint32_t id,
+                     unsigned int types, bool installedOnly,
+                     vector<uint32_t> &path, vector<uint8_t> &edgeTypes);
+
+   RDependencyGraph() : _built(false), _mark(0) {}
+};
+
+#endif
+
+// vim:ts=3:sw=3:et
@@ -0,0 +1,102 @@
+/* rlistdiff.cc - linear time diff of two package lists
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include "rlistdiff.h"
+
+void RListDiff::diff(const vector<unsigned int> &oldList,
+                     const vector<unsigned int> &newList,
+                     unsigned int maxId, const vector<bool> *dirty)
+{
+   removed.clear();
+   inserted.clear();
+   changed.clear();
+   order.clear();
+   reordered = false;
+
+   if (_oldRow.size() < maxId)
+      _oldRow.resize(maxId, -1);
+
+   for (unsigned int i = 0; i < oldList.size(); i++)
+      _oldRow[oldList[i]] = i;
+
+   // walk the new list once, every package either was there before
+   // (kept) or is new; a kept package seen before one that came
+   // earlier in the old list means the order changed
+   vector<bool> kept(oldList.size(), false);
+   vector<int> keptOldRows;
+   int lastRow = -1;
+   for (unsigned int i = 0; i < newList.size(); i++) {
+      unsigned int id = newList[i];
+      int row = _oldRow[id];
+      if (row < 0 || kept[row]) {
+         inserted.push_back(i);
+         continue;
+      }
+      kept[row] = true;
+      keptOldRows.push_back(row);
+      if (row < lastRow)
+         reordered = true;
+      lastRow = row;
+      if (dirty != NULL && id < dirty->size() && (*dirty)[id])
+         changed.push_back(i);
+   }
+
+   // the rows that are left over are gone, last one first
+   for (int i = (int)oldList.size() - 1; i >= 0; i--) {
+      if (!kept[i])
+         removed.push_back(i);
+   }
+
+   if (reordered) {
+      // after the removals and inserts the kept packages still are in
+      // their old order, filling the rows that are not inserted ones
+      vector<int> keptRank(oldList.size(), -1);
+      int rank = 0;
+      for (unsigned int i = 0; i < oldList.size(); i++) {
+         if (kept[i])
+            keptRank[i] = rank++;
+      }
+      vector<int> keptRows;
+      keptRows.reserve(keptOldRows.size());
+      unsigned int next = 0;
+      for (unsigned int i = 0; i < newList.size(); i++) {
+         if (next < inserted.size() && inserted[next] == (int)i)
+            next++;
+         else
+            keptRows.push_back(i);
+      }
+
+      order.resize(newList.size());
+      next = 0;
+      unsigned int k = 0;
+      for (unsigned int i = 0; i < newList.size(); i++) {
+         if (next < inserted.size() && inserted[next] == (int)i) {
+            order[i] = i;
+            next++;
+         } else {
+            order[i] = keptRows[keptRank[keptOldRows[k++]]];
+         }
+      }
+   }
+
+   // leave the lookup table clean for the next run
+   for (unsigned int i = 0; i < oldList.size(); i++)
+      _oldRow[oldList[i]] = -1;
+}
+
+// vim:ts=3:sw=3:et
@@ -0,0 +1,58 @@
+/* rlistdiff.h - linear time diff of two package lists
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RLISTDIFF_H
+#define RLISTDIFF_H
+
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+// Finds the row changes that turn an old list of package ids into a
+// new one. Deleting the "removed" rows of the old list (descending),
+// inserting the "inserted" rows of the new list (ascending) and then
+// applying "order" if the list was reordered gives the new list.
+// "changed" are the rows of packages in both lists marked as dirty.
+class RListDiff {
+ protected:
+   // row in the old list by package id, -1 if not in the old list
+   vector<int> _oldRow;
+
+ public:
+   vector<int> removed;
+   vector<int> inserted;
+   vector<int> changed;
+
+   // set if the packages in both lists are not in the same relative
+   // order; order[i] is then the row (after removals and inserts) of
+   // the package that ends up at row i
+   bool reordered;
+   vector<int> order;
+
+   // ids must be below maxId; dirty is indexed by id and may be NULL
+   void diff(const vector<unsigned int> &oldList,
+             const vector<unsigned int> &newList,
+             unsigned int maxId, const vector<bool> *dirty = NULL);
+
+   RListDiff() : reordered(false) {}
+};
+
+#endif
+
+// vim:ts=3:sw=3:et
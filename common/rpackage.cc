@@ -70,32 +70,18 @@
 
 #include "raptoptions.h"
 
-static int descrBufferSize = 4096;
-static char *descrBuffer = new char[descrBufferSize];
-
-static char *parseDescription(string descr);
+static string parseDescription(string descr);
 
 
 RPackage::RPackage(RPackageLister *lister, pkgDepCache *depcache,
-                   pkgRecords *records, pkgCache::PkgIterator &pkg)
-: _lister(lister), _records(records), _depcache(depcache),
-  _notify(true), _boolFlags(0)
+                   pkgRecords *records, pkgCache::PkgIterator &pkg,
+                   const char *fullname)
+: _lister(lister), fullname(fullname), _records(records),
+  _depcache(depcache), _packageIter(pkg), _package(&_packageIter),
+  _notify(true), _boolFlags(0), _index(0)
 {
-   _package = new pkgCache::PkgIterator(pkg);
-
-#ifdef WITH_APT_MULTIARCH_SUPPORT
-   fullname = _package->FullName(true);
-#endif
-
    pkgDepCache::StateCache & State = (*_depcache)[*_package];
-   if (State.CandVersion != NULL)
-      _defaultCandVer = State.CandVersion;
-}
-
-
-RPackage::~RPackage()
-{
-   delete _package;
+   _defaultCandVer = State.CandVersion != NULL ? State.CandVersion : "";
 }
 
 #if 0
@@ -117,13 +103,12 @@ const char *RPackage::section()
 
 const char *RPackage::srcPackage()
 {
-   static string _srcPkg;
-
    pkgCache::VerIterator ver = (*_depcache)[*_package].CandidateVerIter(*_depcache);
    if (!ver.end()) {
-      pkgRecords::Parser &parser = _records->Lookup(ver.FileList());
-      _srcPkg = parser.SourcePkg().empty() ? name() : parser.SourcePkg();
-      return _srcPkg.c_str();
+      RRecordCache *cache = _lister->getRecordCache();
+      RRecordCache::Record *rec = cache->lookup(ver.FileList());
+      if (rec != NULL && *cache->sourcePkg(rec) != 0)
+         return cache->sourcePkg(rec);
    }
 
    return name();
@@ -132,14 +117,13 @@ const char *RPackage::srcPackage()
 
 const char *RPackage::summary()
 {
-   static string _summary;
-
    pkgCache::VerIterator ver = (*_depcache)[*_package].CandidateVerIter(*_depcache);
    if (!ver.end()) {
       pkgCache::DescIterator Desc = ver.TranslatedDescription();
-      pkgRecords::Parser & parser = _records->Lookup(Desc.FileList());
-      _summary = parser.ShortDesc();
-      return _summary.c_str();
+      RRecordCache *cache = _lister->getRecordCache();
+      RRecordCache::Record *rec = cache->lookup(Desc.FileList());
+      if (rec != NULL)
+         return cache->shortDesc(rec, Desc.LanguageCode());
    }
    return "";
 }
@@ -147,24 +131,34 @@ const char *RPackage::summary()
 
 const char *RPackage::maintainer()
 {
-   static string _maintainer;
    pkgCache::VerIterator ver = (*_depcache)[*_package].CandidateVerIter(*_depcache);
    if (!ver.end()) {
-      pkgRecords::Parser & parser = _records->Lookup(ver.FileList());
-      _maintainer = parser.Maintainer();
-      return _maintainer.c_str();
+      RRecordCache *cache = _lister->getRecordCache();
+      RRecordCache::Record *rec = cache->lookup(ver.FileList());
+      if (rec != NULL)
+         return cache->maintainer(rec);
+   }
+   return "";
+}
+
+string RPackage::maintainer(pkgRecords &records)
+{
+   pkgCache::VerIterator ver = (*_depcache)[*_package].CandidateVerIter(*_depcache);
+   if (!ver.end()) {
+      pkgRecords::Parser & parser = records.Lookup(ver.FileList());
+      return parser.Maintainer();
    }
    return "";
 }
 
 const char *RPackage::homepage()
 {
-   static string _homepage;
    pkgCache::VerIterator ver = (*_depcache)[*_package].CandidateVerIter(*_depcache);
    if (!ver.end()) {
-      pkgRecords::Parser & parser = _records->Lookup(ver.FileList());
-      _homepage = parser.Homepage();
-      return _homepage .c_str();
+      RRecordCache *cache = _lister->getRecordCache();
+      RRecordCache::Record *rec = cache->lookup(ver.FileList());
+      if (rec != NULL)
+         return cache->homepage(rec);
    }
    return "";
 }
@@ -254,17 +248,103 @@ const char *RPackage::installedFiles()
 
 const char *RPackage::description()
 {
-   static string _description;
    pkgCache::VerIterator ver = (*_depcache)[*_package].CandidateVerIter(*_depcache);
-
    if (!ver.end()) {
       pkgCache::DescIterator Desc = ver.TranslatedDescription();
-      pkgRecords::Parser & parser = _records->Lookup(Desc.FileList());
-      _description = parseDescription(parser.LongDesc());
-      return _description.c_str();
-   } else {
-      return "";
+      RRecordCache *cache = _lister->getRecordCache();
+      RRecordCache::Record *rec = cache->lookup(Desc.FileList());
+      if (rec != NULL) {
+         if (!rec->formatted) {
+            rec->description =
+               parseDescription(cache->longDesc(rec, Desc.LanguageCode()));
+            rec->formatted = true;
+         }
+         return rec->description.c_str();
+      }
+   }
+   return "";
+}
+
+// true if the line at p starts the field tag, or tag-lang if lang is
+// given; value is set to what follows the colon
+static bool isField(const char *p, const char *stop, const char *tag,
+                    const char *lang, const char *&value)
+{
+   size_t len = strlen(tag);
+   if ((size_t)(stop - p) <= len || strncasecmp(p, tag, len) != 0)
+      return false;
+   p += len;
+   if (lang != NULL && *lang != 0 && *p == '-') {
+      size_t langLen = strlen(lang);
+      if ((size_t)(stop - p) <= langLen + 1 ||
+          strncasecmp(p + 1, lang, langLen) != 0)
+         return false;
+      p += langLen + 1;
+   }
+   if (*p != ':')
+      return false;
+   value = p + 1;
+   return true;
+}
+
+pkgCache::DescIterator RPackage::candidateDescription()
+{
+   pkgCache::VerIterator ver = (*_depcache)[*_package].CandidateVerIter(*_depcache);
+   if (ver.end())
+      return pkgCache::DescIterator();
+   return ver.TranslatedDescription();
+}
+
+bool RPackage::descriptionText(pkgRecords &records, RTextRef &summary,
+                               RTextRef &rest)
+{
+   return descriptionText(records, candidateDescription(), summary, rest);
+}
+
+bool RPackage::descriptionText(pkgRecords &records,
+                               pkgCache::DescIterator Desc,
+                               RTextRef &summary, RTextRef &rest)
+{
+   summary = rest = RTextRef();
+   if (Desc.end())
+      return false;
+
+   const char *start, *stop;
+   records.Lookup(Desc.FileList()).GetRec(start, stop);
+   if (start == NULL)
+      return false;
+
+   // the description is "Description" in the package files and
+   // "Description-<lang>" in the translations; not "Description-md5"
+   const char *lang = Desc.LanguageCode();
+   const char *value = NULL;
+   for (const char *p = start; p < stop; ) {
+      if (isField(p, stop, "Description", lang, value))
+         break;
+      p = (const char *)memchr(p, '\n', stop - p);
+      if (p == NULL)
+         break;
+      p++;
+   }
+   if (value == NULL)
+      return false;
+
+   while (value < stop && (*value == ' ' || *value == '\t'))
+      value++;
+   const char *eol = (const char *)memchr(value, '\n', stop - value);
+   if (eol == NULL)
+      eol = stop;
+   summary = RTextRef(value, eol);
+
+   // the rest are the following lines that start with a space
+   const char *end = eol;
+   while (end + 1 < stop && (end[1] == ' ' || end[1] == '\t')) {
+      const char *next = (const char *)memchr(end + 1, '\n', stop - end - 1);
+      end = next != NULL ? next : stop;
    }
+   if (end > eol)
+      rest = RTextRef(eol + 1, end);
+   return true;
 }
 
 string RPackage::getRawRecord(bool useCandidateVersion)
@@ -275,12 +355,10 @@ string RPackage::getRawRecord(bool useCandidateVersion)
    if(useCandidateVersion || ver.end())
       ver = (*_depcache)[*_package].CandidateVerIter(*_depcache);
    if(ver.end() == false) {
-      const char *start, *stop;
-      unsigned long len;
-      pkgRecords::Parser &rec=_records->Lookup(ver.FileList());
-      rec.GetRec(start, stop);
-      len = stop-start;
-      return string(start, len);
+      RRecordCache *cache = _lister->getRecordCache();
+      RRecordCache::Record *rec = cache->lookup(ver.FileList());
+      if (rec != NULL)
+         return cache->stanza(rec);
    }
    return string();
 }
@@ -290,16 +368,8 @@ string RPackage::findTagFromPkgRecord(const char *tag)
    pkgCache::VerIterator ver = (*_depcache)[*_package].CandidateVerIter(*_depcache);
 
    if (!ver.end()) {
-      const char *start, *stop;
-      pkgTagSection sec;
-      unsigned long len;
-
-      pkgRecords::Parser &rec=_records->Lookup(ver.FileList());
-      rec.GetRec(start, stop);
-      len = stop-start;
-      // add +1 to ensure we have the double lineline in the buffer
-      if (start && sec.Scan(start, len+1))
-	 return sec.FindS(tag);
+      RRecordCache *cache = _lister->getRecordCache();
+      return cache->findTag(cache->lookup(ver.FileList()), tag);
    }
 
    return string();
@@ -333,6 +403,11 @@ long RPackage::availablePackageSize()
 }
 
 int RPackage::getFlags()
+{
+   return _lister->getCachedFlags(id()) | _boolFlags;
+}
+
+int RPackage::getStateFlags()
 {
    int flags = 0;
 
@@ -400,13 +475,13 @@ int RPackage::getFlags()
    if (state.InstPolicyBroken())
       flags |= FInstPolicyBroken;
 
-   return flags | _boolFlags;
+   return flags;
 }
 
 const char* RPackage::name()
 {
 #ifdef WITH_APT_MULTIARCH_SUPPORT
-   return fullname.c_str();
+   return fullname;
 #else
    const char *s = _package->Name();
    if (s == NULL)
@@ -742,16 +817,24 @@ string RPackage::showWhyInstBroken()
 }
 
 
+pkgCache::VerIterator RPackage::depsVersion(pkgDepCache *depcache,
+                                            const pkgCache::PkgIterator &pkg,
+                                            bool useCandidateVersion)
+{
+   pkgCache::VerIterator Cur;
+
+   if(!useCandidateVersion)
+      Cur = (*depcache)[pkg].InstVerIter(*depcache);
+   if(useCandidateVersion || Cur.end())
+      Cur = (*depcache)[pkg].CandidateVerIter(*depcache);
+   return Cur;
+}
+
 vector<DepInformation> RPackage::enumDeps(bool useCanidateVersion)
 {
    vector<DepInformation> deps;
    DepInformation dep;
-   pkgCache::VerIterator Cur;
-
-   if(!useCanidateVersion)
-      Cur = (*_depcache)[*_package].InstVerIter(*_depcache);
-   if(useCanidateVersion || Cur.end())
-      Cur = (*_depcache)[*_package].CandidateVerIter(*_depcache);
+   pkgCache::VerIterator Cur = depsVersion(useCanidateVersion);
 
    // no information found
    if(Cur.end())
@@ -790,9 +873,11 @@ vector<DepInformation> RPackage::enumDeps(bool useCanidateVersion)
 
 bool RPackage::dependsOn(const char *pkgname)
 {
-   vector<DepInformation> deps = enumDeps();
-   for(unsigned int i=0;i<deps.size();i++)
-      if(strcmp(pkgname, deps[i].name) == 0)
+   pkgCache::VerIterator Cur = depsVersion();
+   if(Cur.end())
+      return false;
+   for(pkgCache::DepIterator D = Cur.DependsList(); D.end() != true; D++)
+      if(strcmp(pkgname, D.TargetPkg().Name()) == 0)
 	 return true;
    return false;
 }
@@ -807,30 +892,9 @@ bool RPackage::isTrusted()
       //cerr << "CanidateVer == 0" << endl;
       return false;
    }
-   pkgSourceList *Sources=_lister->getCache()->list();
-   std::map<pkgCache::PkgFileIterator, pkgIndexFile*>::iterator it;
    for (pkgCache::VerFileIterator i = Ver.FileList(); i.end() == false; i++)
    {
-      pkgIndexFile *Index;
-
-      // FIXME: instead of doing his dance (he trust cache is just
-      //        a couple of items big, that should be done in apt itself
-      it = _lister->getCache()->trust_cache().find(i.File());
-      if (it == _lister->getCache()->trust_cache().end()) {
-         if (Sources->FindIndex(i.File(),Index) == false)
-            continue;
-      } else {
-            Index = (*it).second;
-      }
-      _lister->getCache()->trust_cache().insert(
-         pair<pkgCache::PkgFileIterator, pkgIndexFile*>(i.File(), Index) );
-
-      if (_config->FindB("Debug::pkgAcquire::Auth", false))
-      {
-         std::cerr << "Checking index: " << Index->Describe()
-                   << "(Trusted=" << Index->IsTrusted() << ")\n";
-      }
-      if (Index->IsTrusted())
+      if (_lister->getCache()->isTrusted(i.File()))
          return true;
    }
 
@@ -861,12 +925,14 @@ void RPackage::setNotify(bool flag)
 void RPackage::setAuto(bool flag)
 {
    _depcache->MarkAuto(*_package, flag);
+   _lister->invalidateFlags();
 }
 
 
 void RPackage::setKeep()
 {
    _depcache->MarkKeep(*_package, false);
+   _lister->invalidateFlags();
    if (_notify)
       _lister->notifyChange(this);
    setReInstall(false);
@@ -896,6 +962,7 @@ void RPackage::setInstall()
    _lua->ResetCaches();
 #endif
 
+   _lister->invalidateFlags();
    if (_notify)
       _lister->notifyChange(this);
 }
@@ -903,6 +970,7 @@ void RPackage::setInstall()
 void RPackage::setReInstall(bool flag)
 {
     _depcache->SetReInstall(*_package, flag);
+    _lister->invalidateFlags();
     if (_notify)
 	_lister->notifyChange(this);
 }
@@ -922,6 +990,7 @@ void RPackage::setRemove(bool purge)
    _depcache->SetReInstall(*_package, false);
    _depcache->MarkDelete(*_package, purge);
 
+   _lister->invalidateFlags();
    if (_notify)
       _lister->notifyChange(this);
 }
@@ -1231,6 +1300,7 @@ bool RPackage::setVersion(string verTag)
       break;
    }
 
+   _lister->invalidateCandidates();
    _boolFlags |= FOverrideVersion;
 
    return true;
@@ -1305,8 +1375,8 @@ void RPackage::setRemoveWithDeps(bool shallow, bool purge)
       if (!depackage)
          continue;
 
-      // skip important packages
-      if (depackage->getFlags() & FImportant)
+      // skip important packages (the flag cache is dirty right now)
+      if (depackage->getStateFlags() & FImportant)
          continue;
 
       // skip dependencies that are dependants of other packages
@@ -1320,8 +1390,9 @@ void RPackage::setRemoveWithDeps(bool shallow, bool purge)
 }
 
 
-// description parser stuff
-static char *debParser(string descr)
+// description parser stuff, these keep no state so that descriptions
+// can be parsed from several threads at once
+static string debParser(string descr)
 {
    unsigned int i;
    string::size_type nlpos=0;
@@ -1356,21 +1427,19 @@ static char *debParser(string descr)
 
       nlpos++;
    }
-   strcpy(descrBuffer, descr.c_str());
-   return descrBuffer;
+   return descr;
 }
-static char *rpmParser(string descr)
+static string rpmParser(string descr)
 {
    string::size_type pos = descr.find('\n');
    // delete first line
    if (pos != string::npos)
       descr.erase(0, pos + 2);  // del "\n " too
 
-   strcpy(descrBuffer, descr.c_str());
-   return descrBuffer;
+   return descr;
 }
 
-static char *stripWsParser(string descr)
+static string stripWsParser(string descr)
 {
    const char *end;
    const char *p;
@@ -1380,7 +1449,8 @@ static char *stripWsParser(string descr)
 
 
    int state = 0;
-   char *pp = (char *)descrBuffer;
+   string res;
+   res.reserve(descr.size());
 
    while (p != end) {
       switch (state) {
@@ -1388,42 +1458,35 @@ static char *stripWsParser(string descr)
             if (*p == '\n')
                state = 1;
             else
-               *pp++ = *p;
+               res += *p;
             break;
 
          case 1:
             if (*p == ' ')
                state = 2;
             else {
-               *pp++ = *p;
+               res += *p;
                state = 0;
             }
             break;
 
          case 2:
             if (!(*p == '\n' || *p == '.')) {
-               *pp++ = ' ';
-               *pp++ = *p;
+               res += ' ';
+               res += *p;
             }
             state = 0;
             break;
       }
       p++;
    }
-   *pp = '\0';
 
-   return descrBuffer;
+   return res;
 }
 
 
-static char *parseDescription(string descr)
+static string parseDescription(string descr)
 {
-
-   if (descr.size() + 1 > descrBufferSize) {
-      delete[] descrBuffer;
-      descrBufferSize = descr.size() + 1;
-      descrBuffer = new char[descrBufferSize];
-   }
 #ifdef HAVE_RPM
    int parser = _config->FindI("Synaptic::descriptionParser", NO_PARSER);
 #else
@@ -1438,8 +1501,7 @@ static char *parseDescription(string descr)
          return rpmParser(descr);
       case NO_PARSER:
       default:
-         strcpy(descrBuffer, descr.c_str());
-         return descrBuffer;
+         return descr;
    }
 }
 
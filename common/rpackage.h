@@ -32,6 +32,7 @@
 #define _RPACKAGE_H_
 
 #include <vector>
+#include <cstring>
 
 #include <apt-pkg/pkgcache.h>
 #include <apt-pkg/acquire.h>
@@ -79,6 +80,19 @@ typedef struct  {
    bool isOr;                   // or dependency (with next pkg)
 } DepInformation;
 
+// a piece of text that belongs to someone else, not NUL terminated
+struct RTextRef {
+   const char *start;
+   const char *end;
+
+   RTextRef() : start(NULL), end(NULL) {}
+   RTextRef(const char *s, const char *e) : start(s), end(e) {}
+
+   unsigned long size() const { return end - start; }
+   bool empty() const { return start == end; }
+   string str() const { return string(start, end - start); }
+};
+
 
 class RPackage {
 
@@ -87,13 +101,17 @@ class RPackage {
 
    protected:
 
-   string fullname;
+   // RPackage owns no memory, the lister keeps them all in an arena
+   // and lets them go at once: the name is in the arena too, the
+   // iterator is in here and the version string in the cache
+   const char *fullname;
    pkgRecords *_records;
    pkgDepCache *_depcache;
+   pkgCache::PkgIterator _packageIter;
    pkgCache::PkgIterator *_package;
 
    // save the default candidate version to undo version selection
-   string _defaultCandVer;
+   const char *_defaultCandVer;
 
    bool _notify;
 
@@ -102,6 +120,8 @@ class RPackage {
    bool isShallowDependency(RPackage *pkg);
    int _boolFlags;
 
+   unsigned int _index;
+
  public:
 
    enum Flags {
@@ -131,6 +151,10 @@ class RPackage {
       FInstPolicyBroken  = 1 << 23,
    };
 
+   // flags that live in the RPackage itself, all others come from the
+   // depcache state
+   static const int FBoolFlags = FOrphaned | FPinned | FNew | FOverrideVersion;
+
    enum UpdateImportance {
       IUnknown,
       INormal,
@@ -140,15 +164,42 @@ class RPackage {
 
    pkgCache::PkgIterator *package() { return _package; }
 
+   // the package id in the apt cache, handy to index per package arrays
+   unsigned int id() { return (*_package)->ID; }
+
+   // position in RPackageLister::getPackages(), that is in name order
+   unsigned int index() { return _index; }
+   void setIndex(unsigned int index) { _index = index; }
+
    const char *name();
 
    const char *section();
    const char *priority();
 
+   // these point into the record cache of the lister, which keeps
+   // the last records read; the description is formatted once
    const char *summary();
    const char *description();
    const char *installedFiles();
 
+   // the summary and the rest of the description of the candidate as
+   // they are in the package file, pointing into the buffer of records
+   // until its next lookup. Nothing is copied, for looking at many
+   // packages, from several threads at once when each has its records
+   bool descriptionText(pkgRecords &records, RTextRef &summary,
+                        RTextRef &rest);
+   // the same for a description looked up before with
+   // candidateDescription(); only reads the records, not the package
+   // state, so it can run while the main thread changes it
+   static bool descriptionText(pkgRecords &records,
+                               pkgCache::DescIterator Desc,
+                               RTextRef &summary, RTextRef &rest);
+   // the translated description of the candidate, end() if none
+   pkgCache::DescIterator candidateDescription();
+   // read through the given records instead of the shared ones
+   string maintainer(pkgRecords &records);
+   pkgRecords *records() { return _records; }
+
    string arch();
 
    // package is also available for the native architecture
@@ -214,8 +265,25 @@ class RPackage {
    // reverse dependencies
    vector<DepInformation> enumRDeps();
 
+   // the version enumDeps() lists the dependencies of, end() if there
+   // is none; walk its DependsList() to look at them without copying
+   pkgCache::VerIterator depsVersion(bool useCandidateVersion=false) {
+      return depsVersion(_depcache, *_package, useCandidateVersion);
+   }
+   static pkgCache::VerIterator depsVersion(pkgDepCache *depcache,
+                                            const pkgCache::PkgIterator &pkg,
+                                            bool useCandidateVersion=false);
+   // what enumRDeps() lists, one dependency after the other
+   pkgCache::DepIterator revDependsList() {
+      return _package->RevDependsList();
+   }
+
+   // cheap, reads the flags cached by the lister
    int getFlags();
 
+   // the depcache part of getFlags(), computed from scratch on every call
+   int getStateFlags();
+
    bool wouldBreak();
 
    bool isTrusted();
@@ -247,14 +315,23 @@ class RPackage {
    void unsetVersion();
    string showWhyInstBroken();
 
+   // fullname is kept as it is, see RPackageArena
    RPackage(RPackageLister *lister, pkgDepCache *depcache,
-            pkgRecords *records, pkgCache::PkgIterator &pkg);
-   ~RPackage();
+            pkgRecords *records, pkgCache::PkgIterator &pkg,
+            const char *fullname);
 
    private:
    string getChangelogURI();
 };
 
+// the order RPackageLister keeps its packages in
+struct RPackageNameLess {
+   bool operator() (RPackage *x, RPackage *y) {
+      return strcmp(x->name(), y->name()) < 0;
+   }
+};
+
+
 
 #endif
 
@@ -0,0 +1,99 @@
+/* rpackagearena.cc - storage for the packages of one cache
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include <new>
+#include <cstring>
+
+#include "config.h"
+#include "rpackagearena.h"
+#include "rpackage.h"
+
+RPackageArena::~RPackageArena()
+{
+   for (unsigned int i = 0; i < _blocks.size(); i++)
+      delete [] _blocks[i].data;
+}
+
+void RPackageArena::reset(unsigned int count)
+{
+   // a name is about as big as the package itself
+   size_t wanted = count * 2 * ((sizeof(RPackage) + Align - 1) & ~(Align - 1));
+
+   // only the first block is kept, big enough for a cache like this
+   // one usually
+   unsigned int keep = 0;
+   if (!_blocks.empty() && _blocks[0].size >= wanted)
+      keep = 1;
+   for (unsigned int i = keep; i < _blocks.size(); i++)
+      delete [] _blocks[i].data;
+   _blocks.resize(keep);
+
+   if (_blocks.empty() && wanted > 0) {
+      Block block;
+      block.data = new char[wanted];
+      block.size = wanted;
+      _blocks.push_back(block);
+   }
+   if (!_blocks.empty())
+      _blocks[0].used = 0;
+   _current = 0;
+}
+
+void *RPackageArena::alloc(size_t size)
+{
+   size = (size + Align - 1) & ~(Align - 1);
+
+   while (_current < _blocks.size() &&
+          _blocks[_current].used + size > _blocks[_current].size)
+      _current++;
+
+   if (_current == _blocks.size()) {
+      Block block;
+      block.size = size > BlockSize ? size : BlockSize;
+      block.data = new char[block.size];
+      block.used = 0;
+      _blocks.push_back(block);
+   }
+
+   Block &block = _blocks[_current];
+   void *p = block.data + block.used;
+   block.used += size;
+   return p;
+}
+
+const char *RPackageArena::addString(const string &str)
+{
+   char *p = (char *)alloc(str.size() + 1);
+   memcpy(p, str.c_str(), str.size() + 1);
+   return p;
+}
+
+RPackage *RPackageArena::newPackage(RPackageLister *lister,
+                                    pkgDepCache *depcache,
+                                    pkgRecords *records,
+                                    pkgCache::PkgIterator &pkg)
+{
+   const char *fullname = NULL;
+#ifdef WITH_APT_MULTIARCH_SUPPORT
+   fullname = addString(pkg.FullName(true));
+#endif
+   return new (alloc(sizeof(RPackage)))
+      RPackage(lister, depcache, records, pkg, fullname);
+}
+
+// vim:ts=3:sw=3:et
@@ -0,0 +1,69 @@
+/* rpackagearena.h - storage for the packages of one cache
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RPACKAGEARENA_H
+#define RPACKAGEARENA_H
+
+#include <vector>
+#include <string>
+
+#include <apt-pkg/pkgcache.h>
+
+using namespace std;
+
+class RPackage;
+class RPackageLister;
+class pkgDepCache;
+class pkgRecords;
+
+// The RPackage objects of the open cache and their names, taken one
+// after the other out of a few big blocks instead of one new per
+// package. RPackage owns no memory of its own, so everything is let go
+// at once when the cache is opened again; the blocks are kept for the
+// next cache.
+class RPackageArena {
+ protected:
+   struct Block {
+      char *data;
+      size_t size;
+      size_t used;
+   };
+   vector<Block> _blocks;
+   unsigned int _current;
+
+   static const size_t BlockSize = 64 * 1024;
+   static const size_t Align = 16;
+
+   void *alloc(size_t size);
+
+ public:
+   // forgets all packages, without running their destructors, and
+   // makes room for count packages in the first block
+   void reset(unsigned int count);
+
+   RPackage *newPackage(RPackageLister *lister, pkgDepCache *depcache,
+                        pkgRecords *records, pkgCache::PkgIterator &pkg);
+   const char *addString(const string &str);
+
+   RPackageArena() : _current(0) {}
+   ~RPackageArena();
+};
+
+#endif
+
+// vim:ts=3:sw=3:et
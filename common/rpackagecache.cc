@@ -101,7 +101,7 @@ bool RPackageCache::open(OpProgress &progress, bool locking)
    _dcache = new pkgDepCache(_cache, _policy);
    _dcache->Init(&progress);
 
-   _trust_cache.clear();
+   _trusted.assign(_cache->Head().PackageFileCount, -1);
 
    //progress.Done();
    if (_error->PendingError())
@@ -114,6 +114,26 @@ bool RPackageCache::open(OpProgress &progress, bool locking)
    return true;
 }
 
+bool RPackageCache::isTrusted(pkgCache::PkgFileIterator File)
+{
+   if (File->ID >= _trusted.size())
+      return false;
+   if (_trusted[File->ID] != -1)
+      return _trusted[File->ID];
+
+   // there are only a few files, each one is looked up once
+   pkgIndexFile *Index;
+   bool trusted = false;
+   if (_list->FindIndex(File, Index)) {
+      trusted = Index->IsTrusted();
+      if (_config->FindB("Debug::pkgAcquire::Auth", false))
+         std::cerr << "Checking index: " << Index->Describe()
+                   << "(Trusted=" << trusted << ")\n";
+   }
+   _trusted[File->ID] = trusted;
+   return trusted;
+}
+
 vector<string> RPackageCache::getPolicyArchives(bool filenames_only=false)
 {
    //std::cout << "RPackageCache::getPolicyComponents() " << std::endl;
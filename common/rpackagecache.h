@@ -25,6 +25,7 @@
 #define _RPACKAGECACHE_H_
 
 #include <map>
+#include <vector>
 
 #include <apt-pkg/depcache.h>
 #include <apt-pkg/sourcelist.h>
@@ -45,8 +46,9 @@ class RPackageCache {
    pkgDepCache *_dcache;
    pkgSourceList *_list;
 
-   // speed up IsTrusted()
-   std::map<pkgCache::PkgFileIterator, pkgIndexFile*> _trust_cache;
+   // whether the index of each package file is trusted, by file id:
+   // -1 until it was looked up, then 0 or 1
+   vector<signed char> _trusted;
 
    bool _locked;
 
@@ -57,9 +59,8 @@ class RPackageCache {
    inline pkgSourceList *list() {
       return _list;
    }
-   inline std::map<pkgCache::PkgFileIterator, pkgIndexFile*>& trust_cache() {
-      return _trust_cache;
-   }
+   // false also for files without an index (like the status file)
+   bool isTrusted(pkgCache::PkgFileIterator File);
 
    bool open(OpProgress &progress, bool lock=true);
 
@@ -0,0 +1,244 @@
+/* rpackagecolumns.cc - per column store of the package list data
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include <algorithm>
+
+#include <apt-pkg/pkgsystem.h>
+#include <apt-pkg/version.h>
+
+#include "rpackagecolumns.h"
+#include "rpackagesnapshot.h"
+
+unsigned int RPackageColumns::intern(const string &str)
+{
+   map<string, unsigned int>::iterator I = _stringIds.find(str);
+   if (I != _stringIds.end())
+      return I->second;
+
+   unsigned int id = _strings.size();
+   _strings.push_back(str);
+   _stringIds[str] = id;
+   return id;
+}
+
+struct stringIdLess {
+   const vector<string> &_strings;
+   stringIdLess(const vector<string> &strings) : _strings(strings) {}
+   bool operator() (unsigned int x, unsigned int y) {
+      return _strings[x] < _strings[y];
+   }
+};
+
+// a version string and where its rank goes
+struct versionSlot {
+   const char *version;
+   unsigned int *rank;
+};
+
+struct versionSlotLess {
+   bool operator() (const versionSlot &x, const versionSlot &y) {
+      return _system->VS->CmpVersion(x.version, y.version) < 0;
+   }
+};
+
+void RPackageColumns::clear()
+{
+   _strings.clear();
+   _stringIds.clear();
+   _section.clear();
+   _arch.clear();
+   _installedVersion.clear();
+   _installedSize.clear();
+   _candidate.clear();
+   _availableVersion.clear();
+   _availablePackageSize.clear();
+   _component.clear();
+   _origin.clear();
+   _summary.clear();
+   _hasSummary.clear();
+   _packages.clear();
+   _nameRank.clear();
+   _stringRank.clear();
+   _installedVersionRank.clear();
+   _availableVersionRank.clear();
+   _hasVersionRanks = false;
+}
+
+void RPackageColumns::build(pkgDepCache *deps,
+                            const vector<RPackage *> &packages,
+                            unsigned int packageCount,
+                            const RPackageSnapshot *snapshot)
+{
+   clear();
+   _deps = deps;
+
+   // the ids of the snapshot strings stay the same, the empty string
+   // is the first one there as well
+   if (snapshot != NULL) {
+      for (unsigned int i = 0; i < snapshot->stringCount(); i++)
+         intern(snapshot->getString(i));
+   } else {
+      intern("");
+   }
+
+   _section.resize(packageCount, 0);
+   _arch.resize(packageCount, 0);
+   _installedVersion.resize(packageCount, NULL);
+   _installedSize.resize(packageCount, -1);
+
+   _candidate.resize(packageCount, NULL);
+   _availableVersion.resize(packageCount, NULL);
+   _availablePackageSize.resize(packageCount, -1);
+   _component.resize(packageCount, 0);
+   _origin.resize(packageCount, 0);
+
+   _summary.resize(packageCount);
+   _hasSummary.resize(packageCount, false);
+
+   _packages.resize(packageCount, NULL);
+   _nameRank.resize(packageCount, 0);
+
+   for (unsigned int i = 0; i < packages.size(); i++) {
+      RPackage *pkg = packages[i];
+      unsigned int id = pkg->id();
+
+      if (snapshot != NULL) {
+         _section[id] = snapshot->section(i);
+         _arch[id] = snapshot->arch(i);
+      } else {
+         _section[id] = intern(pkg->section());
+         _arch[id] = intern(pkg->arch());
+      }
+      _installedVersion[id] = pkg->installedVersion();
+      _installedSize[id] = pkg->installedSize();
+
+      pkgCache::Version *cand = (*_deps)[*pkg->package()].CandidateVer;
+      if (snapshot != NULL && cand != NULL &&
+          snapshot->candidate(i) == cand->ID + 1) {
+         // the component and origin strings are known for this version
+         _candidate[id] = cand;
+         _availableVersion[id] = pkg->availableVersion();
+         _availablePackageSize[id] = pkg->availablePackageSize();
+         _component[id] = snapshot->component(i);
+         _origin[id] = snapshot->origin(i);
+      } else {
+         fillCandidate(pkg);
+      }
+      _packages[id] = pkg;
+      _nameRank[id] = i;
+   }
+}
+
+void RPackageColumns::fillCandidate(RPackage *pkg)
+{
+   unsigned int id = pkg->id();
+
+   _candidateChanges++;
+
+   _candidate[id] = (*_deps)[*pkg->package()].CandidateVer;
+   _availableVersion[id] = pkg->availableVersion();
+   _availablePackageSize[id] = pkg->availablePackageSize();
+   _component[id] = intern(pkg->component());
+   _origin[id] = intern(pkg->origin());
+
+   // no need to keep the summary of a version that is gone
+   _summary[id].clear();
+   _hasSummary[id] = false;
+}
+
+const char *RPackageColumns::summary(RPackage *pkg)
+{
+   unsigned int id = row(pkg);
+   if (!_hasSummary[id]) {
+      _summary[id] = pkg->summary();
+      _hasSummary[id] = true;
+   }
+   return _summary[id].c_str();
+}
+
+void RPackageColumns::rankStrings()
+{
+   vector<unsigned int> ids(_strings.size());
+   for (unsigned int i = 0; i < ids.size(); i++)
+      ids[i] = i;
+   sort(ids.begin(), ids.end(), stringIdLess(_strings));
+
+   _stringRank.resize(_strings.size());
+   for (unsigned int i = 0; i < ids.size(); i++)
+      _stringRank[ids[i]] = i;
+}
+
+void RPackageColumns::refreshCandidates()
+{
+   for (unsigned int i = 0; i < _packages.size(); i++) {
+      if (_packages[i] != NULL)
+         row(_packages[i]);
+   }
+}
+
+void RPackageColumns::rankVersions()
+{
+   refreshCandidates();
+
+   _installedVersionRank.assign(_packages.size(), 0);
+   _availableVersionRank.assign(_packages.size(), 0);
+
+   vector<versionSlot> slots;
+   for (unsigned int i = 0; i < _packages.size(); i++) {
+      if (_packages[i] == NULL)
+         continue;
+      if (_installedVersion[i] != NULL) {
+         versionSlot slot = { _installedVersion[i], &_installedVersionRank[i] };
+         slots.push_back(slot);
+      }
+      if (_availableVersion[i] != NULL) {
+         versionSlot slot = { _availableVersion[i], &_availableVersionRank[i] };
+         slots.push_back(slot);
+      }
+   }
+
+   // versions are compared once here instead of in every sort
+   sort(slots.begin(), slots.end(), versionSlotLess());
+
+   unsigned int rank = 0;
+   for (unsigned int i = 0; i < slots.size(); i++) {
+      if (i == 0 || versionSlotLess()(slots[i - 1], slots[i]))
+         rank++;
+      *slots[i].rank = rank;
+   }
+
+   _versionRankChanges = _candidateChanges;
+   _hasVersionRanks = true;
+}
+
+unsigned int RPackageColumns::installedVersionRank(RPackage *pkg)
+{
+   if (!_hasVersionRanks)
+      rankVersions();
+   return _installedVersionRank[pkg->id()];
+}
+
+unsigned int RPackageColumns::availableVersionRank(RPackage *pkg)
+{
+   unsigned int id = row(pkg);
+   if (!_hasVersionRanks || _versionRankChanges != _candidateChanges)
+      rankVersions();
+   return _availableVersionRank[id];
+}
+
+// vim:ts=3:sw=3:et
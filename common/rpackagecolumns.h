@@ -0,0 +1,180 @@
+/* rpackagecolumns.h - per column store of the package list data
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RPACKAGECOLUMNS_H
+#define RPACKAGECOLUMNS_H
+
+#include <vector>
+#include <string>
+#include <map>
+
+#include <apt-pkg/depcache.h>
+
+#include "rpackage.h"
+
+using namespace std;
+
+class RPackageSnapshot;
+
+// The data shown in the package list, kept in one array per column
+// indexed by package id. Strings shared by many packages (section,
+// component, origin, arch) are stored once. The package list and the
+// sort functions read this instead of asking the cache (or, for the
+// summary, the package records) over and over again.
+class RPackageColumns {
+ protected:
+   pkgDepCache *_deps;
+
+   // interned strings, id 0 is the empty string
+   vector<string> _strings;
+   map<string, unsigned int> _stringIds;
+   unsigned int intern(const string &str);
+
+   // filled by build(), the installed version does not change while
+   // the cache is open
+   vector<unsigned int> _section;
+   vector<unsigned int> _arch;
+   vector<const char *> _installedVersion;
+   vector<long> _installedSize;
+
+   // depend on the candidate version and are refilled whenever the
+   // candidate is not the one they were filled for
+   vector<pkgCache::Version *> _candidate;
+   vector<const char *> _availableVersion;
+   vector<long> _availablePackageSize;
+   vector<unsigned int> _component;
+   vector<unsigned int> _origin;
+
+   // filled on first use, the summary needs a record lookup
+   vector<string> _summary;
+   vector<bool> _hasSummary;
+
+   // the packages by id, NULL for ids without one
+   vector<RPackage *> _packages;
+
+   // position of each package in name order
+   vector<unsigned int> _nameRank;
+
+   // position of each interned string in strcmp() order, redone
+   // whenever new strings were interned
+   vector<unsigned int> _stringRank;
+   void rankStrings();
+
+   // position of the installed and candidate versions among all
+   // versions in the cache, equal versions share a rank; redone when
+   // a candidate changed since the last time
+   vector<unsigned int> _installedVersionRank;
+   vector<unsigned int> _availableVersionRank;
+   unsigned int _candidateChanges;
+   unsigned int _versionRankChanges;
+   bool _hasVersionRanks;
+   void rankVersions();
+
+   void fillCandidate(RPackage *pkg);
+
+   inline unsigned int row(RPackage *pkg) {
+      unsigned int id = pkg->id();
+      if ((*_deps)[*pkg->package()].CandidateVer != _candidate[id])
+         fillCandidate(pkg);
+      return id;
+   }
+
+ public:
+   // fills the columns of packages, which have to be in name order,
+   // packageCount is the number of package ids in the cache; the
+   // strings are taken from a snapshot of these packages if given
+   void build(pkgDepCache *deps, const vector<RPackage *> &packages,
+              unsigned int packageCount,
+              const RPackageSnapshot *snapshot = NULL);
+   void clear();
+
+   const char *section(RPackage *pkg) {
+      return _strings[_section[pkg->id()]].c_str();
+   }
+   // the interned string of the section, to index per string tables
+   unsigned int sectionId(RPackage *pkg) {
+      return _section[pkg->id()];
+   }
+   const char *arch(RPackage *pkg) {
+      return _strings[_arch[pkg->id()]].c_str();
+   }
+   unsigned int archId(RPackage *pkg) {
+      return _arch[pkg->id()];
+   }
+   const char *installedVersion(RPackage *pkg) {
+      return _installedVersion[pkg->id()];
+   }
+   long installedSize(RPackage *pkg) {
+      return _installedSize[pkg->id()];
+   }
+
+   const char *availableVersion(RPackage *pkg) {
+      return _availableVersion[row(pkg)];
+   }
+   long availablePackageSize(RPackage *pkg) {
+      return _availablePackageSize[row(pkg)];
+   }
+   const char *component(RPackage *pkg) {
+      return _strings[_component[row(pkg)]].c_str();
+   }
+   const char *origin(RPackage *pkg) {
+      return _strings[_origin[row(pkg)]].c_str();
+   }
+   unsigned int componentId(RPackage *pkg) {
+      return _component[row(pkg)];
+   }
+   unsigned int originId(RPackage *pkg) {
+      return _origin[row(pkg)];
+   }
+   const char *summary(RPackage *pkg);
+
+   unsigned int stringCount() { return _strings.size(); }
+   const string &getString(unsigned int id) { return _strings[id]; }
+
+   // sort keys, comparing them gives the same order as comparing the
+   // values with strcmp() or the version comparison of the system
+   unsigned int nameRank(RPackage *pkg) {
+      return _nameRank[pkg->id()];
+   }
+   unsigned int sectionRank(RPackage *pkg) {
+      if (_stringRank.size() != _strings.size())
+         rankStrings();
+      return _stringRank[_section[pkg->id()]];
+   }
+   unsigned int componentRank(RPackage *pkg) {
+      unsigned int id = row(pkg);
+      if (_stringRank.size() != _strings.size())
+         rankStrings();
+      return _stringRank[_component[id]];
+   }
+   // 0 if there is no such version, 1 for the lowest one
+   unsigned int installedVersionRank(RPackage *pkg);
+   unsigned int availableVersionRank(RPackage *pkg);
+
+   // picks up all candidate changes at once, so that ranks read
+   // afterwards come from the same version table
+   void refreshCandidates();
+
+   RPackageColumns()
+      : _deps(0), _candidateChanges(0), _versionRankChanges(0),
+        _hasVersionRanks(false) {}
+};
+
+#endif
+
+// vim:ts=3:sw=3:et
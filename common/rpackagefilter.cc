@@ -27,6 +27,7 @@
 #include <iostream>
 #include <algorithm>
 #include <cstdio>
+#include <ctype.h>
 #include <fnmatch.h>
 #include <string.h>
 #include <apt-pkg/configuration.h>
@@ -36,6 +37,7 @@
 #include "rpackagefilter.h"
 #include "rpackagelister.h"
 #include "rpackage.h"
+#include "rparallelmatch.h"
 
 #include "i18n.h"
 
@@ -55,6 +57,7 @@ const char *RPatternPackageFilter::TypeName[] = {
    N_("ReverseDepends"),
    N_("Origin"),
    N_("Component"),
+   N_("PulledInBy"),
    NULL
 };
 
@@ -91,18 +94,14 @@ void RSectionPackageFilter::clear()
 }
 
 
-bool RSectionPackageFilter::filter(RPackage *pkg)
+bool RSectionPackageFilter::filterSection(const char *sec)
 {
-   string sec;
-
-   if (pkg->section() == NULL)
+   if (sec == NULL)
       return _inclusive ? false : true;
 
-   sec = pkg->section();
-
    for (vector<string>::const_iterator iter = _groups.begin();
         iter != _groups.end(); iter++) {
-      if (sec == (*iter)) {
+      if ((*iter) == sec) {
          return _inclusive ? true : false;
       }
    }
@@ -110,6 +109,11 @@ bool RSectionPackageFilter::filter(RPackage *pkg)
    return _inclusive ? false : true;
 }
 
+bool RSectionPackageFilter::filter(RPackage *pkg)
+{
+   return filterSection(pkg->section());
+}
+
 
 bool RSectionPackageFilter::write(ofstream &out, string pad)
 {
@@ -144,28 +148,147 @@ bool RSectionPackageFilter::read(Configuration &conf, string key)
 }
 
 
-bool RPatternPackageFilter::filterName(Pattern pat, RPackage *pkg)
+// lower case of the ASCII letters, other bytes are left alone
+static inline unsigned char foldChar(unsigned char c)
+{
+   return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// case folded strstr(), needle is lower case and not empty
+static const char *foldedFind(const char *haystack, size_t hlen,
+                              const string &needle)
+{
+   size_t nlen = needle.size();
+   if (nlen > hlen)
+      return NULL;
+
+   const unsigned char *h = (const unsigned char *)haystack;
+   const unsigned char *n = (const unsigned char *)needle.data();
+   unsigned char first = n[0];
+   unsigned char firstUpper = first;
+   if (first >= 'a' && first <= 'z')
+      firstUpper = first - ('a' - 'A');
+
+   const unsigned char *last = h + hlen - nlen;
+   for (const unsigned char *p = h; p <= last; p++) {
+      if (*p != first && *p != firstUpper)
+         continue;
+      size_t i = 1;
+      while (i < nlen && foldChar(p[i]) == n[i])
+         i++;
+      if (i == nlen)
+         return (const char *)p;
+   }
+   return NULL;
+}
+
+void RPatternPackageFilter::freeTerms(vector<Term> &terms)
+{
+   for (unsigned int i = 0; i < terms.size(); i++) {
+      if (terms[i].regex != NULL) {
+         regfree(terms[i].regex);
+         delete terms[i].regex;
+      }
+   }
+   terms.clear();
+}
+
+bool RPatternPackageFilter::compileTerm(const string &word, Term &term)
+{
+   term.regex = NULL;
+
+   // the words are matched as extended regular expressions, ignoring
+   // the case; the ones that are plain words in ASCII do not need the
+   // regex machinery for that
+   bool literal = true;
+   bool letters = false;
+   for (unsigned int i = 0; i < word.size(); i++) {
+      unsigned char c = word[i];
+      if (i == 0 && c == '^')
+         continue;
+      if (c >= 0x80 || strchr(".[]()*+?{}|^$\\", c) != NULL) {
+         literal = false;
+         break;
+      }
+      if (isalpha(c))
+         letters = true;
+   }
+   bool prefix = !word.empty() && word[0] == '^';
+
+   if (literal && word.size() > (prefix ? 1 : 0)) {
+      term.text = word.substr(prefix ? 1 : 0);
+      for (unsigned int i = 0; i < term.text.size(); i++)
+         term.text[i] = foldChar(term.text[i]);
+      if (prefix)
+         term.kind = Term::Prefix;
+      else
+         term.kind = letters ? Term::CaseLiteral : Term::Literal;
+      return true;
+   }
+
+   term.kind = Term::Regex;
+   term.text = word;
+   term.regex = new regex_t;
+   if (regcomp(term.regex, word.c_str(),
+               REG_EXTENDED | REG_ICASE | REG_NOSUB) != 0) {
+      delete term.regex;
+      term.regex = NULL;
+      return false;
+   }
+   return true;
+}
+
+bool RPatternPackageFilter::matchTerm(const Term &term, const char *str)
+{
+   switch (term.kind) {
+   case Term::Literal:
+      return memmem(str, strlen(str),
+                    term.text.data(), term.text.size()) != NULL;
+   case Term::CaseLiteral:
+      return foldedFind(str, strlen(str), term.text) != NULL;
+   case Term::Prefix:
+      return strncasecmp(str, term.text.c_str(), term.text.size()) == 0;
+   case Term::Regex:
+      return regexec(term.regex, str, 0, NULL, 0) == 0;
+   }
+   return false;
+}
+
+bool RPatternPackageFilter::matchTerm(const Term &term, const RTextRef &text)
+{
+   switch (term.kind) {
+   case Term::Literal:
+      return memmem(text.start, text.size(),
+                    term.text.data(), term.text.size()) != NULL;
+   case Term::CaseLiteral:
+      return foldedFind(text.start, text.size(), term.text) != NULL;
+   case Term::Prefix:
+      return text.size() >= term.text.size() &&
+             strncasecmp(text.start, term.text.c_str(),
+                         term.text.size()) == 0;
+   case Term::Regex:
+      // the only kind that needs the text NUL terminated
+      return regexec(term.regex, text.str().c_str(), 0, NULL, 0) == 0;
+   }
+   return false;
+}
+
+bool RPatternPackageFilter::filterName(const Pattern &pat, RPackage *pkg)
 {
    bool found=true;
 
    const char *name = pkg->name();
-// if we want "real" nouseregexp support, we need to split the string
-// here like we do with regexp
-//              if(!useregexp) {
-//                  if(strcasestr(name, iter->pattern.c_str()) == NULL) {
-//                      found = false;
-//                  } 
-   for (unsigned int i = 0; i < pat.regexps.size(); i++) {
-      if (regexec(pat.regexps[i], name, 0, NULL, 0) == 0)
-	 found &= true;
-      else
+   for (unsigned int i = 0; i < pat.terms.size(); i++) {
+      if (!matchTerm(pat.terms[i], name)) {
 	 found = false;
+	 break;
+      }
    }
    return found;
 }
 
 
-bool RPatternPackageFilter::filterVersion(Pattern pat, RPackage *pkg)
+bool RPatternPackageFilter::filterVersion(const Pattern &pat, RPackage *pkg)
 {
    bool found = true;
 
@@ -175,11 +298,11 @@ bool RPatternPackageFilter::filterVersion(Pattern pat, RPackage *pkg)
    } 
    
    if(version != NULL) {
-      for (unsigned int i = 0; i < pat.regexps.size(); i++) {
-	 if (regexec(pat.regexps[i], version, 0, NULL, 0) == 0)
-	    found &= true;
-	 else
+      for (unsigned int i = 0; i < pat.terms.size(); i++) {
+	 if (!matchTerm(pat.terms[i], version)) {
 	    found = false;
+	    break;
+	 }
       }
    } else {
       found = false;
@@ -187,68 +310,77 @@ bool RPatternPackageFilter::filterVersion(Pattern pat, RPackage *pkg)
    return found;
 }
 
-bool RPatternPackageFilter::filterDescription(Pattern pat, RPackage *pkg)
+bool RPatternPackageFilter::filterDescription(const Pattern &pat,
+                                              RPackage *pkg,
+                                              pkgRecords &records)
 {
    bool found=true;
-   const char *s1 = pkg->summary();
-   const char *s2 = pkg->description();
-   for (unsigned int i = 0; i < pat.regexps.size(); i++) {
-      if (regexec(pat.regexps[i], s1, 0, NULL, 0) == 0) {
-	 found &= true;
-      } else {
-	 if (regexec(pat.regexps[i], s2, 0, NULL, 0) == 0)
-	    found &= true;
-	 else
-	    found = false;
+   // both point into the records, nothing is copied
+   RTextRef summary, rest;
+   pkg->descriptionText(records, summary, rest);
+   // the lines of the rest start with a space, which the formatted
+   // description does not have on its first line
+   if (!rest.empty() && rest.start[0] == ' ')
+      rest.start++;
+   for (unsigned int i = 0; i < pat.terms.size(); i++) {
+      if (matchTerm(pat.terms[i], summary))
+	 continue;
+      if (!matchTerm(pat.terms[i], rest)) {
+	 found = false;
+	 break;
       }
    }
    return found;
 }
 
-bool RPatternPackageFilter::filterMaintainer(Pattern pat, RPackage *pkg)
+bool RPatternPackageFilter::filterMaintainer(const Pattern &pat,
+                                             RPackage *pkg,
+                                             pkgRecords &records)
 {
    bool found=true;
-   const char *maint = pkg->maintainer();
-   for (unsigned int i = 0; i < pat.regexps.size(); i++) {
-      if (regexec(pat.regexps[i], maint, 0, NULL, 0) == 0) {
-	 found &= true;
-      } else {
+   string maintainer = pkg->maintainer(records);
+   const char *maint = maintainer.c_str();
+   for (unsigned int i = 0; i < pat.terms.size(); i++) {
+      if (!matchTerm(pat.terms[i], maint)) {
 	 found = false;
+	 break;
       }
    }
    return found;
 }
 
-bool RPatternPackageFilter::filterDepends(Pattern pat, RPackage *pkg,
+bool RPatternPackageFilter::filterDepends(const Pattern &pat, RPackage *pkg,
 					  pkgCache::Dep::DepType filterType)
 {
-   vector<DepInformation> deps = pkg->enumDeps();
-
-   if (pat.regexps.size() == 0) {
+   if (pat.terms.size() == 0) {
       return true;
    }
-   
-   for(unsigned int i=0;i<deps.size();i++) {
-      if(deps[i].type == filterType) {
-	    if (regexec(pat.regexps[0], deps[i].name, 0, NULL, 0) == 0) {
-	       return true;
-	    }
-      }
+
+   if (isPrepared(pkg->_lister))
+      return pat.matches[pkg->id()];
+
+   pkgCache::VerIterator ver = pkg->depsVersion();
+   if (ver.end())
+      return false;
+   for (pkgCache::DepIterator D = ver.DependsList(); !D.end(); D++) {
+      if (D->Type == filterType &&
+          matchTerm(pat.terms[0], D.TargetPkg().Name()))
+         return true;
    }
    return false;
 }
 
-bool RPatternPackageFilter::filterProvides(Pattern pat, RPackage *pkg)
+bool RPatternPackageFilter::filterProvides(const Pattern &pat, RPackage *pkg)
 {
    bool found = false;
-   vector<string> provides = pkg->provides();
 
-   if (pat.regexps.size() == 0) {
+   if (pat.terms.size() == 0) {
       return true;
    }
    
+   vector<string> provides = pkg->provides();
    for (unsigned int i = 0; i < provides.size(); i++) {
-      if (regexec(pat.regexps[0], provides[i].c_str(), 0, NULL, 0) == 0) {
+      if (matchTerm(pat.terms[0], provides[i].c_str())) {
 	 found = true;
 	 break;
       }
@@ -257,7 +389,8 @@ bool RPatternPackageFilter::filterProvides(Pattern pat, RPackage *pkg)
 }
 
 #if 0
-bool RPatternPackageFilter::filterWeakDepends(Pattern pat, RPackage *pkg)
+bool RPatternPackageFilter::filterWeakDepends(const Pattern &pat,
+                                              RPackage *pkg)
 {
 
    bool found = false;
@@ -265,7 +398,7 @@ bool RPatternPackageFilter::filterWeakDepends(Pattern pat, RPackage *pkg)
    bool ok;
    if (pkg->enumWDeps(depType, depPkg, ok)) {
       do {
-	 if (regexec(pat.regexps[0], depPkg, 0, NULL, 0) == 0) {
+	 if (matchTerm(pat.terms[0], depPkg)) {
 	    found = true;
 	    break;
 	 }
@@ -275,35 +408,35 @@ bool RPatternPackageFilter::filterWeakDepends(Pattern pat, RPackage *pkg)
 }
 #endif
 
-bool RPatternPackageFilter::filterRDepends(Pattern pat, RPackage *pkg)
+bool RPatternPackageFilter::filterRDepends(const Pattern &pat, RPackage *pkg)
 {
-   vector<DepInformation> deps = pkg->enumRDeps();
-
-   if (pat.regexps.size() == 0) {
+   if (pat.terms.size() == 0) {
       return true;
    }
-   
-   for(unsigned int i=0;i<deps.size();i++) {
-      if (regexec(pat.regexps[0], deps[i].name, 0, NULL, 0) == 0) {
-	 return true;
-      }
+
+   if (isPrepared(pkg->_lister))
+      return pat.matches[pkg->id()];
+
+   for (pkgCache::DepIterator D = pkg->revDependsList(); !D.end(); D++) {
+      if (matchTerm(pat.terms[0], D.ParentPkg().Name()))
+         return true;
    }
    return false;
 }
-bool RPatternPackageFilter::filterOrigin(Pattern pat, RPackage *pkg)
+bool RPatternPackageFilter::filterOrigin(const Pattern &pat, RPackage *pkg)
 {
    bool found = false;
-   vector<string>origins = pkg->getCandidateOriginSiteUrls();
 
-   if (pat.regexps.size() == 0) {
+   if (pat.terms.size() == 0) {
       return true;
    }
    
+   vector<string>origins = pkg->getCandidateOriginSiteUrls();
    for (vector<string>::iterator it = origins.begin();
         it != origins.end();
         ++it)
    {
-      if(regexec(pat.regexps[0],(*it).c_str(), 0, NULL, 0) == 0) {
+      if(matchTerm(pat.terms[0], (*it).c_str())) {
          found = true;
       }
    }
@@ -311,31 +444,140 @@ bool RPatternPackageFilter::filterOrigin(Pattern pat, RPackage *pkg)
    return found;
 }
 
-bool RPatternPackageFilter::filterComponent(Pattern pat, RPackage *pkg)
+bool RPatternPackageFilter::filterComponent(const Pattern &pat,
+                                            RPackage *pkg)
 {
    bool found = false;
    string origin;
-   origin = pkg->component();
 
-   if (pat.regexps.size() == 0) {
+   if (pat.terms.size() == 0) {
       return true;
    }
    
-   if(regexec(pat.regexps[0],origin.c_str(), 0, NULL, 0) == 0) {
+   origin = pkg->component();
+   if(matchTerm(pat.terms[0], origin.c_str())) {
       found = true;
    } 
 
    return found;
 }
 
+bool RPatternPackageFilter::filterPulledInBy(const Pattern &pat,
+                                             RPackage *pkg)
+{
+   if (pat.terms.size() == 0) {
+      return true;
+   }
+
+   // there is no cheap way for a single package
+   if (!isPrepared(pkg->_lister))
+      prepare(pkg->_lister);
+   return pat.matches[pkg->id()];
+}
+
+bool RPatternPackageFilter::isPrepared(RPackageLister *lister)
+{
+   return _preparedLister == lister &&
+          _preparedCache == lister->cacheGeneration() &&
+          _preparedCandidates == lister->candidateGeneration();
+}
+
+void RPatternPackageFilter::prepare(RPackageLister *lister)
+{
+   if (isPrepared(lister))
+      return;
+
+   pkgDepCache *deps = lister->getCache()->deps();
+   unsigned int packageCount = deps->Head().PackageCount;
+
+   for (unsigned int i = 0; i < _patterns.size(); i++) {
+      Pattern &pat = _patterns[i];
+      pkgCache::Dep::DepType type = pkgCache::Dep::Depends;
+      switch (pat.where) {
+      case Depends:
+         type = pkgCache::Dep::Depends;
+         break;
+      case Conflicts:
+         type = pkgCache::Dep::Conflicts;
+         break;
+      case Replaces:
+         type = pkgCache::Dep::Replaces;
+         break;
+      case Recommends:
+         type = pkgCache::Dep::Recommends;
+         break;
+      case Suggests:
+         type = pkgCache::Dep::Suggests;
+         break;
+      case RDepends:
+      case PulledInBy:
+         break;
+      default:
+         continue;
+      }
+
+      // without a word everything goes through anyway
+      pat.matches.assign(packageCount, false);
+      if (pat.terms.empty())
+         continue;
+
+      if (pat.where == PulledInBy) {
+         vector<uint32_t> start, ids;
+         for (pkgCache::PkgIterator P = deps->PkgBegin(); !P.end(); P++) {
+            if (matchTerm(pat.terms[0], P.Name()))
+               start.push_back(P->ID);
+         }
+         lister->getDependencyGraph()->closure(start, RDependencyGraph::All,
+                                               false, ids);
+         for (unsigned int j = 0; j < ids.size(); j++)
+            pat.matches[ids[j]] = true;
+         continue;
+      }
+
+      // every name is matched once, virtual packages included
+      for (pkgCache::PkgIterator P = deps->PkgBegin(); !P.end(); P++) {
+         if (!matchTerm(pat.terms[0], P.Name()))
+            continue;
+
+         if (pat.where == RDepends) {
+            // P is a reverse dependency of whatever any of its versions
+            // depends on
+            for (pkgCache::VerIterator V = P.VersionList(); !V.end(); V++)
+               for (pkgCache::DepIterator D = V.DependsList(); !D.end(); D++)
+                  pat.matches[D.TargetPkg()->ID] = true;
+            continue;
+         }
+
+         // the packages depending on P, in the version filterDepends()
+         // looks at
+         for (pkgCache::DepIterator D = P.RevDependsList(); !D.end(); D++) {
+            if (D->Type != type)
+               continue;
+            pkgCache::PkgIterator parent = D.ParentPkg();
+            if (pat.matches[parent->ID])
+               continue;
+            pkgCache::VerIterator ver = RPackage::depsVersion(deps, parent);
+            if (!ver.end() && D.ParentVer()->ID == ver->ID)
+               pat.matches[parent->ID] = true;
+         }
+      }
+   }
+
+   _preparedLister = lister;
+   _preparedCache = lister->cacheGeneration();
+   _preparedCandidates = lister->candidateGeneration();
+}
+
 bool RPatternPackageFilter::filter(RPackage *pkg)
+{
+   return filter(pkg, *pkg->records());
+}
+
+bool RPatternPackageFilter::filter(RPackage *pkg, pkgRecords &records)
 {
    bool found;
    //   bool and_mode = _config->FindB("Synaptic::Filters::andMode", true);
    bool globalfound = and_mode;
-   bool useregexp = _config->FindB("Synaptic::UseRegexp", false);
-
-   bool debug = _config->FindB("Debug::Synaptic::Filters", false);
 
    if (_patterns.size() == 0)
       return true;
@@ -343,16 +585,16 @@ bool RPatternPackageFilter::filter(RPackage *pkg)
    for (vector<Pattern>::const_iterator iter = _patterns.begin();
         iter != _patterns.end(); iter++) {
       
-      Pattern pat = (*iter);
+      const Pattern &pat = (*iter);
       switch(iter->where) {
       case Name:
 	 found = filterName(pat, pkg);
 	 break;
       case Description:
-	 found = filterDescription(pat, pkg);
+	 found = filterDescription(pat, pkg, records);
 	 break;
       case Maintainer:
-	 found = filterMaintainer(pat, pkg);
+	 found = filterMaintainer(pat, pkg, records);
 	 break;
       case Version:
 	 found = filterVersion(pat,pkg);
@@ -384,11 +626,14 @@ bool RPatternPackageFilter::filter(RPackage *pkg)
       case Component:
 	 found = filterComponent(pat, pkg);
 	 break;
+      case PulledInBy:
+	 found = filterPulledInBy(pat, pkg);
+	 break;
       default:
 	 cerr << "unknown pattern package filter (shouldn't happen) " << endl;
       }
 
-      if (found && debug)
+      if (found && _debug)
          clog << "RPatternPackageFilter::filter match for "
               << pkg->name() << endl;
 
@@ -418,28 +663,26 @@ void RPatternPackageFilter::addPattern(DepType type, string pattern,
    pat.pattern = pattern;
    pat.exclusive = exclusive;
 
-   // compile the regexps
+   _debug = _config->FindB("Debug::Synaptic::Filters", false);
+
+   // split and classify the words
    string S;
    const char *C = pattern.c_str();
 
-   vector<regex_t *> regexps;
    while (*C != 0) {
       if (ParseQuoteWord(C, S) == true) {
-         regex_t *reg = new regex_t;
-         if (regcomp(reg, S.c_str(), REG_EXTENDED | REG_ICASE | REG_NOSUB) !=
-             0) {
+         Term term;
+         if (!compileTerm(S, term)) {
             cerr << "regexp compilation error" << endl;
-            for (unsigned int i = 0; i < regexps.size(); i++) {
-               regfree(regexps[i]);
-            }
+            freeTerms(pat.terms);
             return;
          }
-         regexps.push_back(reg);
+         pat.terms.push_back(term);
       }
    }
-   pat.regexps = regexps;
 
    _patterns.push_back(pat);
+   _preparedLister = NULL;
 }
 
 
@@ -500,10 +743,18 @@ bool RPatternPackageFilter::read(Configuration &conf, string key)
    return true;
 }
 
+RPatternPackageFilter::RPatternPackageFilter()
+   : _preparedLister(NULL), and_mode(true)
+{
+   _debug = _config->FindB("Debug::Synaptic::Filters", false);
+}
+
 // copy constructor
 RPatternPackageFilter::RPatternPackageFilter(RPatternPackageFilter &f)
+   : _preparedLister(NULL)
 {
    //cout << "RPatternPackageFilter(&RPatternPackageFilter f)" << endl;
+   _debug = f._debug;
    for (unsigned int i = 0; i < f._patterns.size(); i++) {
       addPattern(f._patterns[i].where,
                  f._patterns[i].pattern, f._patterns[i].exclusive);
@@ -514,14 +765,11 @@ RPatternPackageFilter::RPatternPackageFilter(RPatternPackageFilter &f)
 void RPatternPackageFilter::clear()
 {
    // give back all the memory
-   for (unsigned int i = 0; i < _patterns.size(); i++) {
-      for (unsigned int j = 0; j < _patterns[i].regexps.size(); j++) {
-         regfree(_patterns[i].regexps[j]);
-         delete(regex_t *) _patterns[i].regexps[j];
-      }
-   }
+   for (unsigned int i = 0; i < _patterns.size(); i++)
+      freeTerms(_patterns[i].terms);
 
    _patterns.erase(_patterns.begin(), _patterns.end());
+   _preparedLister = NULL;
 }
 
 
@@ -667,6 +915,43 @@ bool RStatusPackageFilter::filter(RPackage *pkg)
 }
 
 
+void RStatusPackageFilter::lowerToFlags(int &anyFlags, bool &notInstalled,
+                                        bool &manualInstalled, int &slowStatus)
+{
+   static const struct {
+      int status;
+      int flags;
+   } flagTests[] = {
+      { MarkKeep, RPackage::FKeep },
+      { MarkInstall, RPackage::FInstall | RPackage::FReInstall },
+      { MarkRemove, RPackage::FRemove },
+      { Installed, RPackage::FInstalled },
+      { Broken, RPackage::FNowBroken },
+      { Upgradable, RPackage::FOutdated },
+      { NewPackage, RPackage::FNew },
+      { OrphanedPackage, RPackage::FOrphaned },
+      { PinnedPackage, RPackage::FPinned },
+      { ResidualConfig, RPackage::FResidualConfig },
+      { NotInstallable, RPackage::FNotInstallable },
+      { AutoInstalled, RPackage::FIsAuto },
+      { Garbage, RPackage::FIsGarbage },
+      { 0, 0 }
+   };
+
+   anyFlags = 0;
+   for (int i = 0; flagTests[i].status != 0; i++) {
+      if (_status & flagTests[i].status)
+         anyFlags |= flagTests[i].flags;
+   }
+   notInstalled = (_status & NotInstalled) != 0;
+   manualInstalled = (_status & ManualInstalled) != 0;
+
+   // Broken also checks wouldBreak(), UpstreamUpgradable compares the
+   // versions and NowPolicyBroken looks at the reverse dependencies
+   slowStatus = _status & (Broken | UpstreamUpgradable | NowPolicyBroken);
+}
+
+
 bool RStatusPackageFilter::write(ofstream &out, string pad)
 {
    char buf[16];
@@ -863,6 +1148,111 @@ bool RFilter::apply(RPackage *package)
 }
 
 
+void RFilter::compile(RPackageLister *lister)
+{
+   _plan.columns = lister->getColumns();
+
+   status.lowerToFlags(_plan.anyFlags, _plan.notInstalled,
+                       _plan.manualInstalled, _plan.slowStatus);
+   // every package is either installed or not
+   _plan.checkStatus = !(_plan.notInstalled &&
+                         (_plan.anyFlags & RPackage::FInstalled));
+
+   _plan.checkSection = section.count() > 0 || section.inclusive();
+   _plan.sections.clear();
+   if (_plan.checkSection) {
+      unsigned int n = _plan.columns->stringCount();
+      _plan.sections.resize(n);
+      for (unsigned int i = 0; i < n; i++) {
+         const string &sec = _plan.columns->getString(i);
+         _plan.sections[i] = section.filterSection(sec.c_str());
+      }
+   }
+
+   // the priority filter lets everything through
+   _plan.checkPattern = pattern.count() > 0;
+   _plan.checkReducedView = !reducedview.hidesNothing();
+   _plan.checkFile = !file.hidesNothing();
+}
+
+bool RFilter::passStatus(RPackage *pkg)
+{
+   int flags = pkg->getFlags();
+
+   if (flags & _plan.anyFlags)
+      return true;
+   if (_plan.notInstalled && !(flags & RPackage::FInstalled))
+      return true;
+   if (_plan.manualInstalled &&
+       (flags & (RPackage::FInstalled | RPackage::FIsAuto)) ==
+       RPackage::FInstalled)
+      return true;
+
+   return _plan.slowStatus != 0 && status.filter(pkg);
+}
+
+bool RFilter::passSection(RPackage *pkg)
+{
+   unsigned int id = _plan.columns->sectionId(pkg);
+   if (id < _plan.sections.size())
+      return _plan.sections[id];
+   return section.filter(pkg);
+}
+
+struct patternMatcher : public RPackageMatcher {
+   RPatternPackageFilter &_pattern;
+   patternMatcher(RPatternPackageFilter &pattern) : _pattern(pattern) {}
+   bool match(RPackage *pkg, pkgRecords &records) {
+      return _pattern.filter(pkg, records);
+   }
+};
+
+void RFilter::apply(const vector<RPackage *> &pkgs,
+                    vector<RPackage *> &result)
+{
+   if (pkgs.empty())
+      return;
+   compile(pkgs[0]->_lister);
+
+   // each stage narrows the list down for the next one, the cheap
+   // lookups go first
+   vector<RPackage *> survivors;
+   survivors.reserve(pkgs.size());
+   for (unsigned int i = 0; i < pkgs.size(); i++) {
+      RPackage *pkg = pkgs[i];
+      if (pkg == NULL)
+         continue;
+      if (_plan.checkStatus && !passStatus(pkg))
+         continue;
+      if (_plan.checkSection && !passSection(pkg))
+         continue;
+      survivors.push_back(pkg);
+   }
+
+   if (_plan.checkReducedView || _plan.checkFile) {
+      unsigned int n = 0;
+      for (unsigned int i = 0; i < survivors.size(); i++) {
+         RPackage *pkg = survivors[i];
+         if (_plan.checkReducedView && !reducedview.filter(pkg))
+            continue;
+         if (_plan.checkFile && !file.filter(pkg))
+            continue;
+         survivors[n++] = pkg;
+      }
+      survivors.resize(n);
+   }
+
+   // the patterns may need the package records, they are matched on
+   // all processors
+   if (_plan.checkPattern) {
+      pattern.prepare(pkgs[0]->_lister);
+      patternMatcher matcher(pattern);
+      RMatchPackages(survivors, matcher, result);
+   } else {
+      result.insert(result.end(), survivors.begin(), survivors.end());
+   }
+}
+
 void RFilter::reset()
 {
    section.reset();
@@ -41,6 +41,7 @@ using namespace std;
 
 class RPackage;
 class RPackageLister;
+class RPackageColumns;
 
 class Configuration;
 
@@ -92,6 +93,9 @@ class RSectionPackageFilter : public RPackageFilter {
    string section(int index);
    void clear();
 
+   // the result for packages in the given section
+   bool filterSection(const char *section);
+
    virtual bool filter(RPackage *pkg);
    virtual bool read(Configuration &conf, string key);
    virtual bool write(ofstream &out, string pad);
@@ -114,37 +118,70 @@ class RPatternPackageFilter : public RPackageFilter {
       Suggests,
       RDepends,                  // reverse depends
       Origin,                   // package origin (like security.debian.org)
-      Component                   // package component (e.g. main)
+      Component,                  // package component (e.g. main)
+      PulledInBy                // all the dependencies, direct or not
    } DepType;
 
 
  protected:
+   // a word of a pattern, classified by addPattern() so that only the
+   // words with regex meta characters go through regexec()
+   struct Term {
+      enum Kind {
+         Literal,               // substring without letters
+         CaseLiteral,           // substring, compared case folded
+         Prefix,                // "^word", compared case folded
+         Regex
+      } kind;
+      string text;              // lower case for CaseLiteral and Prefix
+      regex_t *regex;           // only for Regex
+   };
    struct Pattern {
       DepType where;
       string pattern;
       bool exclusive;
-        vector<regex_t *> regexps;
+      vector<Term> terms;
+      // for the dependency patterns, the ids of the packages they match,
+      // see prepare()
+      vector<bool> matches;
    };
    vector<Pattern> _patterns;
 
-   bool and_mode; // patterns are applied in "AND" mode if true, "OR" if false
+   // what the matches of the patterns were worked out for; they only
+   // read the dependencies of the installed or candidate versions, so
+   // marking packages leaves them alone
+   RPackageLister *_preparedLister;
+   unsigned int _preparedCache;
+   unsigned int _preparedCandidates;
+   bool isPrepared(RPackageLister *lister);
 
-   inline bool filterName(Pattern pat, RPackage *pkg);
-   inline bool filterVersion(Pattern pat, RPackage *pkg);
-   inline bool filterDescription(Pattern pat, RPackage *pkg);
-   inline bool filterMaintainer(Pattern pat, RPackage *pkg);
-   inline bool filterDepends(Pattern pat, RPackage *pkg,
+   bool and_mode; // patterns are applied in "AND" mode if true, "OR" if false
+   bool _debug;
+
+   static bool compileTerm(const string &word, Term &term);
+   static void freeTerms(vector<Term> &terms);
+   static bool matchTerm(const Term &term, const char *str);
+   static bool matchTerm(const Term &term, const RTextRef &text);
+
+   inline bool filterName(const Pattern &pat, RPackage *pkg);
+   inline bool filterVersion(const Pattern &pat, RPackage *pkg);
+   inline bool filterDescription(const Pattern &pat, RPackage *pkg,
+                                 pkgRecords &records);
+   inline bool filterMaintainer(const Pattern &pat, RPackage *pkg,
+                                pkgRecords &records);
+   inline bool filterDepends(const Pattern &pat, RPackage *pkg,
 			     pkgCache::Dep::DepType filterType);
-   inline bool filterProvides(Pattern pat, RPackage *pkg);
-   inline bool filterRDepends(Pattern pat, RPackage *pkg);
-   inline bool filterOrigin(Pattern pat, RPackage *pkg);
-   inline bool filterComponent(Pattern pat, RPackage *pkg);
+   inline bool filterProvides(const Pattern &pat, RPackage *pkg);
+   inline bool filterRDepends(const Pattern &pat, RPackage *pkg);
+   inline bool filterOrigin(const Pattern &pat, RPackage *pkg);
+   inline bool filterComponent(const Pattern &pat, RPackage *pkg);
+   inline bool filterPulledInBy(const Pattern &pat, RPackage *pkg);
 
  public:
 
    static const char *TypeName[];
 
-   RPatternPackageFilter() : and_mode(true) {}
+   RPatternPackageFilter();
    RPatternPackageFilter(RPatternPackageFilter &f);
    virtual ~RPatternPackageFilter();
 
@@ -164,7 +201,16 @@ class RPatternPackageFilter : public RPackageFilter {
    bool getAndMode() { return and_mode; }
    void setAndMode(bool b) { and_mode=b; }
 
+   // works out which packages the dependency patterns match for the
+   // whole cache at once, going from the package names that match to
+   // the packages depending on them, instead of walking the dependencies
+   // of every package filtered; filter() may run in many threads after
+   // it, until the cache or the package states change
+   void prepare(RPackageLister *lister);
+
    virtual bool filter(RPackage *pkg);
+   // reads the descriptions through records, see RMatchPackages()
+   bool filter(RPackage *pkg, pkgRecords &records);
    virtual bool read(Configuration &conf, string key);
    virtual bool write(ofstream &out, string pad);
 };
@@ -202,6 +248,14 @@ class RStatusPackageFilter : public RPackageFilter {
 
    RStatusPackageFilter() : _status(~0)
    {}
+
+   // the tests that only look at RPackage::getFlags(): a package
+   // passes if it has one of anyFlags, if it is not installed and
+   // notInstalled is set or if it is installed by hand and
+   // manualInstalled is set; slowStatus are the status bits that need
+   // filter() on the packages that fail all of that
+   void lowerToFlags(int &anyFlags, bool &notInstalled,
+                     bool &manualInstalled, int &slowStatus);
    inline virtual void reset() { _status = ~0; }
 
    inline virtual const char *type() { return RPFStatus; }
@@ -262,6 +316,11 @@ class RReducedViewPackageFilter : public RPackageFilter {
 
    void enable() { _enabled = true; }
    void disable() { _enabled = false; }
+
+   // filter() lets every package through
+   bool hidesNothing() {
+      return _hide.empty() && _hide_wildcard.empty() && _hide_regex.empty();
+   }
 };
 
 extern const char *RPFFile;
@@ -283,6 +342,9 @@ class RFilePackageFilter : public RPackageFilter {
 
    bool addFile(string file);
 
+   // filter() lets every package through
+   bool hidesNothing() { return pkgs.empty(); }
+
    virtual bool filter(RPackage *pkg);
    virtual bool read(Configuration &conf, string key);
    virtual bool write(ofstream &out, string pad);
@@ -306,6 +368,16 @@ struct RFilter {
    bool apply(RPackage *package);
    void reset();
 
+   // lowers the filter to a plan for applying it to many packages at
+   // once: the status and section tests become lookups on the flags
+   // and the interned section, the pattern, reduced view and file
+   // tests are run last and only on the packages that got past them
+   void compile(RPackageLister *lister);
+
+   // appends the packages of pkgs the filter lets through to result,
+   // in the same order; compiles the filter first
+   void apply(const vector<RPackage *> &pkgs, vector<RPackage *> &result);
+
    RSectionPackageFilter section;
    RPatternPackageFilter pattern;
    RStatusPackageFilter status;
@@ -318,6 +390,28 @@ struct RFilter {
    protected:
 
    string name;
+
+   struct Plan {
+      RPackageColumns *columns;
+
+      bool checkStatus;
+      int anyFlags;
+      bool notInstalled;
+      bool manualInstalled;
+      int slowStatus;
+
+      // indexed by interned section id
+      bool checkSection;
+      vector<bool> sections;
+
+      bool checkPattern;
+      bool checkReducedView;
+      bool checkFile;
+   };
+   Plan _plan;
+
+   bool passStatus(RPackage *pkg);
+   bool passSection(RPackage *pkg);
 };
 
 
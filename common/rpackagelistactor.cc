@@ -10,28 +10,49 @@
 #include <algorithm>
 #include <fnmatch.h>
 
-void RPackageListActor::notifyPostFilteredChange()
+static void getPackageIds(const vector<RPackage *> &pkgs,
+                          vector<unsigned int> &ids)
 {
-   vector<RPackage *> removedList;
-   vector<RPackage *> insertedList;
-
-   const vector<RPackage *> &currentList = _lister->getViewPackages();
+   ids.resize(pkgs.size());
+   for (unsigned int i = 0; i < pkgs.size(); i++)
+      ids[i] = pkgs[i]->id();
+}
 
-   removedList = _lastDisplayList;
+void RPackageListActor::updateState()
+{
+   getPackageIds(_lister->getViewPackages(), _lastDisplayList);
+}
 
-   vector<RPackage *>::iterator I;
-   for (unsigned int i = 0; i < currentList.size(); i++) {
-      I = find(removedList.begin(), removedList.end(), currentList[i]);
-      if (I != removedList.end())
-	 removedList.erase(I);
-      else
-         insertedList.push_back(currentList[i]);
+void RPackageListActor::notifyPostFilteredChange()
+{
+   vector<unsigned int> currentList;
+   getPackageIds(_lister->getViewPackages(), currentList);
+
+   unsigned int maxId = _lister->getCache()->deps()->Head().PackageCount;
+
+   // without a list of changes every package may have changed
+   vector<RPackage *> changes;
+   vector<bool> dirty;
+   if (_lister->getLastChanges(changes)) {
+      dirty.resize(maxId, false);
+      for (unsigned int i = 0; i < changes.size(); i++)
+         dirty[changes[i]->id()] = true;
+   } else {
+      dirty.resize(maxId, true);
    }
 
-   if (removedList.empty() == false)
-      run(removedList, PKG_REMOVED);
-   if (insertedList.empty() == false)
-      run(insertedList, PKG_ADDED);
+   _diff.diff(_lastDisplayList, currentList, maxId, &dirty);
+
+   if (_diff.removed.empty() == false)
+      run(_diff.removed, PKG_REMOVED);
+   if (_diff.inserted.empty() == false)
+      run(_diff.inserted, PKG_ADDED);
+   if (_diff.reordered)
+      run(_diff.order, PKG_REORDERED);
+   if (_diff.changed.empty() == false)
+      run(_diff.changed, PKG_CHANGED);
+
+   _lastDisplayList.swap(currentList);
 }
 
 // vim:ts=3:sw=3:et
@@ -24,6 +24,7 @@
 #define RPACKAGELISTACTOR_H
 
 #include "rpackagelister.h"
+#include "rlistdiff.h"
 #include <iostream>
 
 class RPackageListActor : public RPackageObserver {
@@ -32,17 +33,25 @@ class RPackageListActor : public RPackageObserver {
 
    enum listEvent {
       PKG_ADDED,
-      PKG_REMOVED
+      PKG_REMOVED,
+      PKG_CHANGED,
+      PKG_REORDERED
    };
 
    protected:
 
    RPackageLister *_lister;
-   vector<RPackage *> _lastDisplayList;
+
+   // ids of the packages that were shown before the change
+   vector<unsigned int> _lastDisplayList;
+   RListDiff _diff;
 
    public:
 
-   virtual void run(vector<RPackage *> &List, int listEvent) = 0;
+   // called with the rows of each kind of change in the order they
+   // have to be applied: removed, added, reordered, changed (see
+   // RListDiff for what the rows refer to)
+   virtual void run(vector<int> &rows, int listEvent) = 0;
 
    virtual void notifyPreFilteredChange() {
       updateState();
@@ -51,9 +60,7 @@ class RPackageListActor : public RPackageObserver {
    virtual void notifyPostFilteredChange();
    virtual void notifyChange(RPackage *pkg) {}
 
-   virtual void updateState() {
-      _lastDisplayList = _lister->getPackages();
-   }
+   virtual void updateState();
 
    RPackageListActor(RPackageLister *lister)
          : _lister(lister) {
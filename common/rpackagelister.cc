@@ -37,6 +37,7 @@
 #include <unistd.h>
 #include <time.h>
 #include <algorithm>
+#include <iterator>
 
 #include "rpackagelister.h"
 #include "rpackagecache.h"
@@ -45,6 +46,7 @@
 #include "raptoptions.h"
 #include "rinstallprogress.h"
 #include "rcacheactor.h"
+#include "rparallelmatch.h"
 
 #include <apt-pkg/error.h>
 #include <apt-pkg/progress.h>
@@ -89,18 +91,26 @@ RPackageLister::RPackageLister()
    _searchData.isRegex = false;
    _viewMode = _config->FindI("Synaptic::ViewMode", 0);
    _updating = true;
+   _flagCacheDirty = true;
+   _cacheGeneration = 0;
+   _stateGeneration = 0;
+   _candidateGeneration = 0;
+   _changeSetCache = 0;
+   _changeSetState = 0;
+   _viewStateValid = false;
+   _lastChangesValid = false;
    _sortMode = LIST_SORT_DEFAULT;
 
    // keep order in sync with rpackageview.h 
-   _views.push_back(new RPackageViewSections(_nativeArchPackages));
-   _views.push_back(new RPackageViewStatus(_nativeArchPackages));
-   _views.push_back(new RPackageViewOrigin(_nativeArchPackages));
-   _filterView = new RPackageViewFilter(_nativeArchPackages);
+   _views.push_back(new RPackageViewSections(_packages, _nativeArchPackages));
+   _views.push_back(new RPackageViewStatus(_packages, _nativeArchPackages));
+   _views.push_back(new RPackageViewOrigin(_packages, _nativeArchPackages));
+   _filterView = new RPackageViewFilter(_packages, _nativeArchPackages);
    _views.push_back(_filterView);
-   _searchView =  new RPackageViewSearch(_nativeArchPackages);
+   _searchView =  new RPackageViewSearch(_packages, _nativeArchPackages);
    _views.push_back(_searchView);
    // its import that we use "_packages" here instead of _nativeArchPackages
-   _views.push_back(new RPackageViewArchitecture(_packages));
+   _views.push_back(new RPackageViewArchitecture(_packages, _packages));
 #ifdef WITH_EPT
    openXapianIndex();
 #endif
@@ -124,6 +134,8 @@ RPackageLister::RPackageLister()
 
 RPackageLister::~RPackageLister()
 {
+   _searchIndexer.stop();
+
    for (vector<RCacheActor *>::iterator I = _actors.begin();
         I != _actors.end(); I++)
       delete(*I);
@@ -141,6 +153,8 @@ void RPackageLister::setView(unsigned int index)
       _selectedView = _views[index];
    else
       _selectedView = _views[0];
+
+   _viewStateValid = false;
 }
 
 vector<string> RPackageLister::getViews()
@@ -153,9 +167,23 @@ vector<string> RPackageLister::getViews()
 
 vector<string> RPackageLister::getSubViews()
 {
+   updateView(_selectedView);
    return _selectedView->getSubViews();
 }
 
+void RPackageLister::updateView(RPackageView *view)
+{
+   if (view->isCurrent(_cacheGeneration, _stateGeneration))
+      return;
+
+   if(_config->FindB("Debug::Synaptic::View",false))
+      ioprintf(clog, "RPackageLister::updateView(): '%s'\n",
+	       view->getName().c_str());
+
+   view->refresh();
+   view->setCurrent(_cacheGeneration, _stateGeneration);
+}
+
 bool RPackageLister::setSubView(string newSubView)
 {
    if(_config->FindB("Debug::Synaptic::View",false))
@@ -167,6 +195,7 @@ bool RPackageLister::setSubView(string newSubView)
    else
       _selectedView->setSelected(newSubView);
 
+   _viewStateValid = false;
    notifyChange(NULL);
 
    if(_config->FindB("Debug::Synaptic::View",false))
@@ -202,7 +231,16 @@ void RPackageLister::notifyPostChange(RPackage *pkg)
       ioprintf(clog, "RPackageLister::notifyPostChange(): '%s'\n",
 	       pkg == NULL ? "NULL" : pkg->name());
 
-   reapplyFilter();
+   // the depcache may have been changed behind our back
+   invalidateFlags();
+
+   // only touch what changed unless the view needs a full rebuild
+   _lastChanges.clear();
+   _lastChangesValid = _viewStateValid &&
+                       getChangedPackages(_lastChanges) &&
+                       refreshChangedPackages(_lastChanges);
+   if (!_lastChangesValid)
+      reapplyFilter();
 
    for (vector<RPackageObserver *>::const_iterator I =
         _packageObservers.begin(); I != _packageObservers.end(); I++) {
@@ -305,6 +343,14 @@ bool RPackageLister::openCache()
    // Flush old errors
    _error->Discard();
 
+   // the indexer reads the packages that are about to go away
+   _searchIndexer.stop();
+   _searchCache.clear();
+   _recordCache.setRecords(NULL);
+   _depGraph.clear();
+   _lastSearch.clear();
+   _cacheGeneration++;
+
    // only lock if we run as root
    bool lock = true;
    if(getuid() != 0)
@@ -319,6 +365,8 @@ bool RPackageLister::openCache()
 
    pkgDepCache *deps = _cache->deps();
 
+   _viewStateValid = false;
+
    // Apply corrections for half-installed packages
    if (pkgApplyStatus(*deps) == false) {
       _cacheValid = false;
@@ -335,6 +383,7 @@ bool RPackageLister::openCache()
    if (_records)
       delete _records;
    _records = new pkgRecords(*deps);
+   _recordCache.setRecords(_records);
 
    if (_error->PendingError()) {
       _cacheValid = false;
@@ -342,12 +391,10 @@ bool RPackageLister::openCache()
                              "Please report."), 3);
    }
 
-   for (vector<RPackage *>::iterator I = _packages.begin();
-        I != _packages.end(); I++)
-      delete (*I);
-
+   // the packages of the last cache go away all at once
    int packageCount = deps->Head().PackageCount;
    _packages.clear();
+   _arena.reset(packageCount);
    _packages.reserve(packageCount);
 
    _nativeArchPackages.clear();
@@ -356,15 +403,32 @@ bool RPackageLister::openCache()
    _packagesIndex.clear();
    _packagesIndex.resize(packageCount, -1);
 
+   _flagCache.assign(packageCount, 0);
+   _flagCacheDirty = true;
+
    string pkgName;
-   int count = 0;
 
    bool showAllMultiArch = _config->FindB("Synaptic::ShowAllMultiArch", false);
 
    _installedCount = 0;
 
-   map<string, RPackage *> pkgmap;
-   set<string> sectionSet;
+   // a snapshot of the last start saves sorting the packages and
+   // interning the column strings, if the cache did not change since
+   struct stat buf;
+   if (stat(_config->FindFile("Dir::Cache::pkgcache").c_str(), &buf) != 0)
+      buf.st_mtime = buf.st_size = 0;
+   vector<string> snapshotFiles;
+   snapshotFiles.push_back(RStateDir() + "/pkgsnapshot");
+   snapshotFiles.push_back(RConfDir() + "/pkgsnapshot");
+   RPackageSnapshot snapshot;
+   bool haveSnapshot = false;
+   for (unsigned int i = 0; buf.st_mtime != 0 && i < snapshotFiles.size(); i++) {
+      if (snapshot.load(snapshotFiles[i]) &&
+          snapshot.isCurrent(buf.st_mtime, buf.st_size, packageCount)) {
+         haveSnapshot = true;
+         break;
+      }
+   }
 
    for (unsigned int i = 0; i != _views.size(); i++)
       _views[i]->clear();
@@ -377,19 +441,12 @@ bool RPackageLister::openCache()
       else if (I->VersionList == 0)
          continue; // Exclude virtual packages.
 
-      RPackage *pkg = new RPackage(this, deps, _records, I);
-      _packagesIndex[I->ID] = count;
+      RPackage *pkg = _arena.newPackage(this, deps, _records, I);
+      _packagesIndex[pkg->id()] = _packages.size();
       _packages.push_back(pkg);
-      count++;
-
-      // this is what is feed to the views
-      if (showAllMultiArch || !pkg->isMultiArchDuplicate())
-         _nativeArchPackages.push_back(pkg);
 
       pkgName = pkg->name();
 
-      pkgmap[pkgName] = pkg;
-
       // Find out about new packages.
       if (firstRun) {
          packageNames.insert(pkgName);
@@ -406,20 +463,45 @@ bool RPackageLister::openCache()
 
       if (_roptions->getPackageLock(pkgName.c_str())) 
 	 pkg->setPinned(true);
+   }
 
-      // Gather list of sections.
-      if (I.Section())
-         sectionSet.insert(I.Section());
-#if 0 // may confuse users
-      else
-         cerr << "Package " << I.Name() << " has no section?!" << endl;
-#endif
+   // keep the packages in name order, so everything built from them
+   // (the views in particular) comes out sorted by name already
+   if (haveSnapshot)
+      haveSnapshot = snapshotOrder(snapshot);
+   if (!haveSnapshot)
+      sort(_packages.begin(), _packages.end(), RPackageNameLess());
+   for (unsigned int i = 0; i < _packages.size(); i++) {
+      RPackage *pkg = _packages[i];
+      pkg->setIndex(i);
+      _packagesIndex[pkg->id()] = i;
+
+      // this is what is feed to the views
+      bool duplicate = haveSnapshot ? snapshot.isMultiArchDuplicate(i)
+                                    : pkg->isMultiArchDuplicate();
+      if (showAllMultiArch || !duplicate)
+         _nativeArchPackages.push_back(pkg);
    }
 
-   // refresh the views
-   for (unsigned int i = 0; i != _views.size(); i++)
-      _views[i]->refresh();
+   if (haveSnapshot) {
+      _columns.build(deps, _packages, packageCount, &snapshot);
+   } else {
+      _columns.build(deps, _packages, packageCount);
+      // saved in the first place that can be written to
+      if (buf.st_mtime != 0 && !_packages.empty()) {
+         snapshot.build(deps, _packages, _columns, buf.st_mtime,
+                        buf.st_size);
+         for (unsigned int i = 0; i < snapshotFiles.size(); i++) {
+            if (snapshot.save(snapshotFiles[i]))
+               break;
+         }
+      }
+   }
+   snapshot.clear();
+   startSearchIndex();
 
+   // the views are built when they are looked at, reapplyFilter()
+   // does the selected one
    applyInitialSelection();
 
    _updating = false;
@@ -509,6 +591,13 @@ RPackage *RPackageLister::getPackage(string name)
    return NULL;
 }
 
+void RPackageLister::refreshFlags()
+{
+   for (unsigned int i = 0; i < _packages.size(); i++)
+      _flagCache[_packages[i]->id()] = _packages[i]->getStateFlags();
+   _flagCacheDirty = false;
+}
+
 int RPackageLister::getPackageIndex(RPackage *pkg)
 {
    return _packagesIndex[(*pkg->package())->ID];
@@ -527,6 +616,7 @@ bool RPackageLister::fixBroken()
    if (_cache->deps()->BrokenCount() == 0)
       return true;
 
+   invalidateFlags();
    if (pkgFixBroken(*_cache->deps()) == false
        || _cache->deps()->BrokenCount() != 0)
       return _error->Error(_("Unable to correct dependencies"));
@@ -541,6 +631,7 @@ bool RPackageLister::fixBroken()
 
 bool RPackageLister::upgrade()
 {
+   invalidateFlags();
    if (pkgAllUpgrade(*_cache->deps()) == false) {
       return _error->
          Error(_("Internal Error, AllUpgrade broke stuff. Please report."));
@@ -560,6 +651,7 @@ bool RPackageLister::upgrade()
 
 bool RPackageLister::distUpgrade()
 {
+   invalidateFlags();
    if (pkgDistUpgrade(*_cache->deps()) == false) {
       cout << _("dist upgrade Failed") << endl;
       return false;
@@ -585,185 +677,264 @@ void RPackageLister::reapplyFilter()
    if(_config->FindB("Debug::Synaptic::View",false))
       clog << "RPackageLister::reapplyFilter()" << endl;
 
-   _selectedView->refresh();
+   _lastChangesValid = false;
+
+   updateView(_selectedView);
    _viewPackages.clear();
-   _viewPackagesIndex.clear();
-   _viewPackagesIndex.resize(_packagesIndex.size(), -1);
-
-   for (RPackageView::iterator I = _selectedView->begin();
-        I != _selectedView->end(); I++) {
-      if (*I) {
-         _viewPackagesIndex[(*(*I)->package())->ID] = _viewPackages.size();
-         _viewPackages.push_back(*I);
-      }
-   }
 
+   _selectedView->getPackages(_viewPackages);
 
+   // sorting builds the _viewPackagesIndex
    sortPackages(_sortMode);
-}
-
-static const int status_sort_magic = (  RPackage::FInstalled 
-				      | RPackage::FOutdated 
-				      | RPackage::FNew);
-struct statusSortFunc {
-   bool operator() (RPackage *x, RPackage *y) {
-      return (x->getFlags() & (status_sort_magic))  <
-	     (y->getFlags() & (status_sort_magic));
-}};
 
-struct instSizeSortFunc {
-   bool operator() (RPackage *x, RPackage *y) {
-      return x->installedSize() < y->installedSize();
-}};
+   _viewState.resize(_packages.size());
+   for (unsigned int i = 0; i < _packages.size(); i++)
+      _viewState[i] = _packages[i]->getFlags();
+   _viewStateValid = true;
+}
 
-struct dlSizeSortFunc {
-   bool operator() (RPackage *x, RPackage *y) {
-      return x->availablePackageSize() < y->availablePackageSize();
-}};
+bool RPackageLister::getChangedPackages(vector<RPackage *> &changed)
+{
+   // past this many changes a full rebuild is cheaper
+   unsigned int limit = _config->FindI("Synaptic::IncrementalViewLimit", 1000);
 
-struct componentSortFunc {
-   bool operator() (RPackage *x, RPackage *y) {
-      return x->component() < y->component();
-}};
+   for (unsigned int i = 0; i < _packages.size(); i++) {
+      int flags = _packages[i]->getFlags();
+      if (flags == _viewState[i])
+         continue;
+      if (changed.size() >= limit)
+         return false;
+      _viewState[i] = flags;
+      changed.push_back(_packages[i]);
+   }
 
-struct sectionSortFunc {
-   bool operator() (RPackage *x, RPackage *y) {
-      return std::strcmp(x->section(), y->section())<0;
-}};
+   if(_config->FindB("Debug::Synaptic::View",false))
+      ioprintf(clog, "RPackageLister::getChangedPackages(): %i changed\n",
+	       (int)changed.size());
 
-// version string compare
-int verstrcmp(const char *x, const char *y)
-{
-   if(x && y) 
-      return _system->VS->CmpVersion(x, y) < 0;
-   
-   // if we compare with a non-existring version
-   if(y == NULL)
-      return false;
    return true;
 }
 
-struct versionSortFunc {
-   bool operator() (RPackage *x, RPackage *y) {
-      return verstrcmp(y->availableVersion(),
-		       x->availableVersion());
-   }
-};
+static const int status_sort_magic = (  RPackage::FInstalled 
+				      | RPackage::FOutdated 
+				      | RPackage::FNew);
 
-struct instVersionSortFunc {
-   bool operator() (RPackage *x, RPackage *y) {
-      return verstrcmp(y->installedVersion(),
-		       x->installedVersion());
-}};
+// sizes as sort keys, no size sorts first
+static uint32_t sizeKey(long size)
+{
+   if (size < 0)
+      return 0;
+   if (size >= 0xffffffffL)
+      return 0xffffffff;
+   return size + 1;
+}
 
-struct supportedPartFunc {
- protected:
-   bool _ascent;
-   RPackageStatus _status;
- public:
-   supportedPartFunc(bool ascent, RPackageStatus &s) 
-      : _ascent(ascent), _status(s) {};
-   bool operator() (RPackage *x) {
-      return (_ascent==_status.isSupported(x));
+static bool descendingSort(RPackageLister::listSortMode mode)
+{
+   switch(mode) {
+   case RPackageLister::LIST_SORT_NAME_DES:
+   case RPackageLister::LIST_SORT_SIZE_DES:
+   case RPackageLister::LIST_SORT_SUPPORTED_DES:
+   case RPackageLister::LIST_SORT_SECTION_DES:
+   case RPackageLister::LIST_SORT_COMPONENT_DES:
+   case RPackageLister::LIST_SORT_DLSIZE_DES:
+   case RPackageLister::LIST_SORT_STATUS_DES:
+   case RPackageLister::LIST_SORT_VERSION_DES:
+   case RPackageLister::LIST_SORT_INST_VERSION_DES:
+      return true;
+   default:
+      return false;
    }
-};
-
-struct nameSortFunc {
-   bool operator() (RPackage *x, RPackage *y) {
-      return std::strcmp(x->name(), y->name())<0;
-}};
-
-
+}
 
-void RPackageLister::sortPackages(vector<RPackage *> &packages, 
-				  listSortMode mode)
+uint64_t RPackageLister::sortKey(RPackage *pkg, listSortMode mode)
 {
-   _sortMode = mode;
-   if (packages.empty())
-      return;
-
-   if(_config->FindB("Debug::Synaptic::View",false))
-      clog << "RPackageLister::sortPackages(): " << packages.size() << endl;
-
-   /* Always sort by name to have packages ordered inside another sort 
-    * criteria */
-   sort(packages.begin(), packages.end(), 
-      sortFunc<nameSortFunc>(true));
+   uint32_t key = 0;
 
    switch(mode) {
-   case LIST_SORT_NAME_ASC:
    case LIST_SORT_DEFAULT:
-      // Do nothing, already done
+   case LIST_SORT_NAME_ASC:
       break;
    case LIST_SORT_NAME_DES:
-      sort(packages.begin(), packages.end(), 
-		  sortFunc<nameSortFunc>(false));
+      key = _columns.nameRank(pkg);
       break;
    case LIST_SORT_SIZE_ASC:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<instSizeSortFunc>(true));
-      break;
    case LIST_SORT_SIZE_DES:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<instSizeSortFunc>(false));
+      key = sizeKey(_columns.installedSize(pkg));
       break;
    case LIST_SORT_DLSIZE_ASC:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<dlSizeSortFunc>(true));
-      break;
    case LIST_SORT_DLSIZE_DES:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<dlSizeSortFunc>(false));
+      key = sizeKey(_columns.availablePackageSize(pkg));
       break;
    case LIST_SORT_COMPONENT_ASC:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<componentSortFunc>(true));
-      break;
    case LIST_SORT_COMPONENT_DES:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<componentSortFunc>(false));
+      key = _columns.componentRank(pkg);
       break;
    case LIST_SORT_SECTION_ASC:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<sectionSortFunc>(true));
-      break;
    case LIST_SORT_SECTION_DES:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<sectionSortFunc>(false));
+      key = _columns.sectionRank(pkg);
       break;
    case LIST_SORT_STATUS_ASC:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<statusSortFunc>(true));
-      break;
    case LIST_SORT_STATUS_DES:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<statusSortFunc>(false));
+      key = pkg->getFlags() & status_sort_magic;
       break;
    case LIST_SORT_SUPPORTED_ASC:
-      stable_partition(packages.begin(), packages.end(), 
-		  supportedPartFunc(false, _pkgStatus));
-      break;
    case LIST_SORT_SUPPORTED_DES:
-      stable_partition(packages.begin(), packages.end(), 
-		  supportedPartFunc(true, _pkgStatus));
+      key = _pkgStatus.isSupported(pkg) ? 1 : 0;
       break;
+   // ascending version order is newest first, packages without the
+   // version last
    case LIST_SORT_VERSION_ASC:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<versionSortFunc>(true));
-      break;
    case LIST_SORT_VERSION_DES:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<versionSortFunc>(false));
+      key = ~_columns.availableVersionRank(pkg);
       break;
    case LIST_SORT_INST_VERSION_ASC:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<instVersionSortFunc>(true));
-      break;
    case LIST_SORT_INST_VERSION_DES:
-      stable_sort(packages.begin(), packages.end(), 
-		  sortFunc<instVersionSortFunc>(false));
+      key = ~_columns.installedVersionRank(pkg);
       break;
    }
+
+   if (descendingSort(mode))
+      key = ~key;
+
+   // packages with the same key stay in name order
+   return ((uint64_t)key << 32) | _columns.nameRank(pkg);
+}
+
+// LSD radix sort of the packages by their keys, 16 bits per pass;
+// passes over digits that all keys share are skipped
+static void radixSort(vector<uint64_t> &keys, vector<RPackage *> &packages)
+{
+   unsigned int n = keys.size();
+   vector<uint64_t> sortedKeys(n);
+   vector<RPackage *> sortedPackages(n);
+   vector<unsigned int> count(1 << 16);
+
+   for (int shift = 0; shift < 64; shift += 16) {
+      count.assign(count.size(), 0);
+      for (unsigned int i = 0; i < n; i++)
+         count[(keys[i] >> shift) & 0xffff]++;
+      if (count[(keys[0] >> shift) & 0xffff] == n)
+         continue;
+
+      unsigned int pos = 0;
+      for (unsigned int d = 0; d < count.size(); d++) {
+         unsigned int c = count[d];
+         count[d] = pos;
+         pos += c;
+      }
+
+      for (unsigned int i = 0; i < n; i++) {
+         unsigned int j = count[(keys[i] >> shift) & 0xffff]++;
+         sortedKeys[j] = keys[i];
+         sortedPackages[j] = packages[i];
+      }
+      keys.swap(sortedKeys);
+      packages.swap(sortedPackages);
+   }
+}
+
+// the order sortPackages() leaves the packages in
+struct viewOrderFunc {
+ protected:
+   RPackageLister *_lister;
+   RPackageLister::listSortMode _mode;
+ public:
+   viewOrderFunc(RPackageLister *lister, RPackageLister::listSortMode mode)
+      : _lister(lister), _mode(mode) {};
+   bool operator() (RPackage *x, RPackage *y) {
+      return _lister->sortKey(x, _mode) < _lister->sortKey(y, _mode);
+   }
+};
+
+bool RPackageLister::refreshChangedPackages(const vector<RPackage *> &changed)
+{
+   if (changed.empty())
+      return true;
+
+   vector<RPackage *> visible;
+   if (!_selectedView->refreshPackages(changed, visible))
+      return false;
+   // the changes since the view was built are all in there
+   _selectedView->setCurrent(_cacheGeneration, _stateGeneration);
+
+   // drop the changed packages from the (sorted) list and merge the
+   // ones that are still visible back in at their new position
+   vector<bool> isChanged(_packagesIndex.size(), false);
+   for (unsigned int i = 0; i < changed.size(); i++)
+      isChanged[changed[i]->id()] = true;
+
+   vector<RPackage *> kept;
+   kept.reserve(_viewPackages.size());
+   for (unsigned int i = 0; i < _viewPackages.size(); i++) {
+      if (!isChanged[_viewPackages[i]->id()])
+         kept.push_back(_viewPackages[i]);
+   }
+
+   _columns.refreshCandidates();
+   viewOrderFunc order(this, _sortMode);
+   sort(visible.begin(), visible.end(), order);
+
+   _viewPackages.clear();
+   _viewPackages.reserve(kept.size() + visible.size());
+   merge(kept.begin(), kept.end(), visible.begin(), visible.end(),
+         back_inserter(_viewPackages), order);
+
+   updateViewPackagesIndex();
+
+   return true;
+}
+
+void RPackageLister::updateViewPackagesIndex()
+{
+   _viewPackagesIndex.assign(_packagesIndex.size(), -1);
+   for (unsigned int i = 0; i < _viewPackages.size(); i++)
+      _viewPackagesIndex[_viewPackages[i]->id()] = i;
+}
+
+void RPackageLister::sortPackages(listSortMode mode)
+{
+   sortPackages(_viewPackages, mode);
+   updateViewPackagesIndex();
+}
+
+
+
+void RPackageLister::sortPackages(vector<RPackage *> &packages, 
+				  listSortMode mode)
+{
+   _sortMode = mode;
+   if (packages.empty())
+      return;
+
+   if(_config->FindB("Debug::Synaptic::View",false))
+      clog << "RPackageLister::sortPackages(): " << packages.size() << endl;
+
+   // views hand out their packages in name order, which is all that
+   // is needed for a name sort and keeps the stable radix sort from
+   // having to look at the name rank for everything else
+   bool nameOrdered = true;
+   for (unsigned int i = 1; i < packages.size() && nameOrdered; i++) {
+      if (_columns.nameRank(packages[i - 1]) > _columns.nameRank(packages[i]))
+         nameOrdered = false;
+   }
+   if (nameOrdered && (mode == LIST_SORT_NAME_ASC || mode == LIST_SORT_DEFAULT))
+      return;
+
+   // the keys of all packages have to come from the same candidates
+   _columns.refreshCandidates();
+
+   // one key per package instead of looking up both sides of every
+   // comparison, the name rank in the key keeps equal packages
+   // ordered by name
+   vector<uint64_t> keys(packages.size());
+   for (unsigned int i = 0; i < packages.size(); i++) {
+      keys[i] = sortKey(packages[i], mode);
+      if (nameOrdered)
+         keys[i] &= 0xffffffff00000000ULL;
+   }
+
+   radixSort(keys, packages);
 }
 
 int RPackageLister::findPackage(const char *pattern)
@@ -850,77 +1021,6 @@ void RPackageLister::getDownloadSummary(int &dlCount, double &dlSize)
 }
 
 
-void RPackageLister::getSummary(int &held, int &kept, int &essential,
-                                int &toInstall, int &toReInstall,
-				int &toUpgrade, int &toRemove,
-                                int &toDowngrade, int &unauthenticated,
-				double &sizeChange)
-{
-   pkgDepCache *deps = _cache->deps();
-   unsigned i;
-
-   held = 0;
-   kept = 0;
-   essential = 0;
-   toInstall = 0;
-   toReInstall = 0;
-   toUpgrade = 0;
-   toDowngrade = 0;
-   toRemove = 0;
-   unauthenticated =0;
-
-   for (i = 0; i < _packages.size(); i++) {
-      int flags = _packages[i]->getFlags();
-
-      // These flags will never be set together.
-      int status = flags & (RPackage::FKeep |
-                            RPackage::FNewInstall |
-                            RPackage::FReInstall |
-                            RPackage::FUpgrade |
-                            RPackage::FDowngrade |
-                            RPackage::FRemove);
-
-#ifdef WITH_APT_AUTH
-      switch(status) {
-      case RPackage::FNewInstall:
-      case RPackage::FInstall:
-      case RPackage::FReInstall:
-      case RPackage::FUpgrade:
-	 if(!_packages[i]->isTrusted()) 
-	    unauthenticated++;
-	 break;
-      }
-#endif
-
-      switch (status) {
-         case RPackage::FKeep:
-            if (flags & RPackage::FHeld)
-               held++;
-            else
-               kept++;
-            break;
-         case RPackage::FNewInstall:
-            toInstall++;
-            break;
-         case RPackage::FReInstall:
-            toReInstall++;
-            break;
-         case RPackage::FUpgrade:
-            toUpgrade++;
-            break;
-         case RPackage::FDowngrade:
-            toDowngrade++;
-            break;
-         case RPackage::FRemove:
-            if (flags & RPackage::FImportant)
-               essential++;
-            toRemove++;
-            break;
-      }
-   }
-
-   sizeChange = deps->UsrSize();
-}
 
 
 
@@ -930,28 +1030,17 @@ struct bla:public binary_function<RPackage *, RPackage *, bool> {
    }
 };
 
+#ifdef HAVE_RPM
 void RPackageLister::saveUndoState(pkgState &state)
 {
    undoStack.push_front(state);
    redoStack.clear();
 
-#ifdef HAVE_RPM
    unsigned int maxStackSize = _config->FindI("Synaptic::undoStackSize", 3);
-#else
-   unsigned int maxStackSize = _config->FindI("Synaptic::undoStackSize", 20);
-#endif
    while (undoStack.size() > maxStackSize)
       undoStack.pop_back();
 }
 
-void RPackageLister::saveUndoState()
-{
-   pkgState state;
-   saveState(state);
-   saveUndoState(state);
-}
-
-
 void RPackageLister::undo()
 {
    pkgState state;
@@ -982,7 +1071,89 @@ void RPackageLister::redo()
    redoStack.pop_front();
    restoreState(state);
 }
+#else
+// only the packages that changed are kept, so the stack can be deep
+void RPackageLister::saveUndoState(pkgState &state)
+{
+   undoState changes;
+   for (unsigned int i = 0; i < _packages.size() && i < state.size(); i++) {
+      int flags = _packages[i]->getFlags();
+      if (state[i] != flags) {
+         flagChange change = { i, state[i], flags };
+         changes.push_back(change);
+      }
+   }
+   if (changes.empty())
+      return;
 
+   undoStack.push_front(undoState());
+   undoStack.front().swap(changes);
+   redoStack.clear();
+
+   unsigned int maxStackSize = _config->FindI("Synaptic::undoStackSize", 500);
+   while (undoStack.size() > maxStackSize)
+      undoStack.pop_back();
+}
+
+void RPackageLister::undo()
+{
+   if (undoStack.empty())
+      return;
+
+   applyChanges(undoStack.front(), true);
+   redoStack.splice(redoStack.begin(), undoStack, undoStack.begin());
+}
+
+void RPackageLister::redo()
+{
+   if (redoStack.empty())
+      return;
+
+   applyChanges(redoStack.front(), false);
+   undoStack.splice(undoStack.begin(), redoStack, redoStack.begin());
+}
+
+void RPackageLister::markFlags(RPackage *pkg, int flags, bool autoInst)
+{
+   pkgDepCache *deps = _cache->deps();
+
+   // the cached flags do not see the marks done before
+   flags &= ~RPackage::FBoolFlags;
+   if (flags == pkg->getStateFlags())
+      return;
+
+   if (flags & RPackage::FReInstall) {
+      deps->MarkInstall(*(pkg->package()), autoInst);
+      deps->SetReInstall(*(pkg->package()), false);
+   } else if (flags & RPackage::FInstall) {
+      deps->MarkInstall(*(pkg->package()), autoInst);
+   } else if (flags & RPackage::FRemove) {
+      deps->MarkDelete(*(pkg->package()), flags & RPackage::FPurge);
+   } else if (flags & RPackage::FKeep) {
+      deps->MarkKeep(*(pkg->package()), false);
+   }
+   // fix the auto flag
+   deps->MarkAuto(*pkg->package(), (flags & RPackage::FIsAuto));
+}
+
+void RPackageLister::applyChanges(const undoState &changes, bool old)
+{
+   {
+      RActionGroup group(this);
+
+      // every package the action changed is in there, so nothing is
+      // installed automatically on the way
+      for (unsigned int i = 0; i < changes.size(); i++) {
+         const flagChange &change = changes[i];
+         if (change.index < _packages.size())
+            markFlags(_packages[change.index],
+                      old ? change.oldFlags : change.newFlags, false);
+      }
+   }
+
+   notifyChange(NULL);
+}
+#endif
 
 #ifdef HAVE_RPM
 void RPackageLister::saveState(RPackageLister::pkgState &state)
@@ -1073,29 +1244,13 @@ void RPackageLister::saveState(RPackageLister::pkgState &state)
 
 void RPackageLister::restoreState(RPackageLister::pkgState &state)
 {
-   pkgDepCache *deps = _cache->deps();
-   pkgDepCache::ActionGroup group(*deps);
+   {
+      RActionGroup group(this);
 
-   for (unsigned i = 0; i < _packages.size(); i++) {
-      RPackage *pkg = _packages[i];
-      int flags = pkg->getFlags();
-      int oldflags = state[i];
-
-      if (oldflags != flags) {
-         if (oldflags & RPackage::FReInstall) {
-            deps->MarkInstall(*(pkg->package()), true);
-            deps->SetReInstall(*(pkg->package()), false);
-         } else if (oldflags & RPackage::FInstall) {
-            deps->MarkInstall(*(pkg->package()), true);
-         } else if (oldflags & RPackage::FRemove) {
-            deps->MarkDelete(*(pkg->package()), oldflags & RPackage::FPurge);
-         } else if (oldflags & RPackage::FKeep) {
-            deps->MarkKeep(*(pkg->package()), false);
-	 }
-	 // fix the auto flag
-	 deps->MarkAuto(*pkg->package(), (oldflags & RPackage::FIsAuto));
-      }
+      for (unsigned i = 0; i < _packages.size(); i++)
+         markFlags(_packages[i], state[i], true);
    }
+
    notifyChange(NULL);
 }
 
@@ -1113,6 +1268,10 @@ bool RPackageLister::getStateChanges(RPackageLister::pkgState &state,
 {
    bool changed = false;
 
+   vector<bool> excluded(_packages.size(), false);
+   for (unsigned int i = 0; i < exclude.size(); i++)
+      excluded[exclude[i]->index()] = true;
+
    for (unsigned i = 0; i < _packages.size(); i++) {
       int flags = _packages[i]->getFlags();
 
@@ -1139,7 +1298,7 @@ bool RPackageLister::getStateChanges(RPackageLister::pkgState &state,
 	    }
 	 }
 	 
-	 if(find(exclude.begin(), exclude.end(),_packages[i]) != exclude.end())
+	 if(excluded[i])
 	    continue;
 
          switch (status) {
@@ -1176,114 +1335,118 @@ bool RPackageLister::getStateChanges(RPackageLister::pkgState &state,
       }
    }
 
-   if (sorted == true && changed == true) {
-      if (toKeep.empty() == false)
-         sort(toKeep.begin(), toKeep.end(), bla());
-      if (toInstall.empty() == false)
-         sort(toInstall.begin(), toInstall.end(), bla());
-      if (toReInstall.empty() == false)
-         sort(toReInstall.begin(), toReInstall.end(), bla());
-      if (toUpgrade.empty() == false)
-         sort(toUpgrade.begin(), toUpgrade.end(), bla());
-      if (toRemove.empty() == false)
-         sort(toRemove.begin(), toRemove.end(), bla());
-      if (toDowngrade.empty() == false)
-         sort(toDowngrade.begin(), toDowngrade.end(), bla());
-
-   }
+   // _packages is in name order, there is nothing left to sort
 
    return changed;
 }
 #endif
 
-void RPackageLister::getDetailedSummary(vector<RPackage *> &held,
-                                        vector<RPackage *> &kept,
-                                        vector<RPackage *> &essential,
-                                        vector<RPackage *> &toInstall,
-                                        vector<RPackage *> &toReInstall,
-                                        vector<RPackage *> &toUpgrade,
-                                        vector<RPackage *> &toRemove,
-                                        vector<RPackage *> &toPurge,
-                                        vector<RPackage *> &toDowngrade,
-#ifdef WITH_APT_AUTH
-					vector<string> &notAuthenticated,
-#endif
-                                        double &sizeChange)
+void RChangeSet::clear()
 {
-   pkgDepCache *deps = _cache->deps();
+   held.clear();
+   kept.clear();
+   essential.clear();
+   toInstall.clear();
+   toReInstall.clear();
+   toUpgrade.clear();
+   toRemove.clear();
+   toPurge.clear();
+   toDowngrade.clear();
+   unauthenticated = 0;
+   notAuthenticated.clear();
+   notAuthenticatedDone = false;
+   sizeChange = 0;
+}
 
-   for (unsigned int i = 0; i < _packages.size(); i++) {
-      RPackage *pkg = _packages[i];
-      int flags = pkg->getFlags();
-
-      // These flags will never be set together.
-      int status = flags & (RPackage::FKeep |
-                            RPackage::FNewInstall |
-                            RPackage::FReInstall |
-                            RPackage::FUpgrade |
-                            RPackage::FDowngrade |
-                            RPackage::FRemove);
-
-      switch (status) {
-
-         case RPackage::FKeep:
-            if (flags & RPackage::FHeld)
-               held.push_back(pkg);
-            else
-               kept.push_back(pkg);
-            break;
+const RChangeSet &RPackageLister::getChangeSet(bool withAuthentication)
+{
+   RChangeSet &changes = _changeSet;
 
-         case RPackage::FNewInstall:
-            toInstall.push_back(pkg);
-            break;
+   if (_changeSetCache != _cacheGeneration ||
+       _changeSetState != _stateGeneration) {
+      changes.clear();
 
-         case RPackage::FReInstall:
-            toReInstall.push_back(pkg);
-            break;
+      // _packages is in name order, so are the lists
+      for (unsigned int i = 0; i < _packages.size(); i++) {
+         RPackage *pkg = _packages[i];
+         int flags = pkg->getFlags();
 
-         case RPackage::FUpgrade:
-            toUpgrade.push_back(pkg);
-            break;
+         // These flags will never be set together.
+         int status = flags & (RPackage::FKeep |
+                               RPackage::FNewInstall |
+                               RPackage::FReInstall |
+                               RPackage::FUpgrade |
+                               RPackage::FDowngrade |
+                               RPackage::FRemove);
 
-         case RPackage::FDowngrade:
-            toDowngrade.push_back(pkg);
-            break;
+         switch (status) {
+            case RPackage::FKeep:
+               if (flags & RPackage::FHeld)
+                  changes.held.push_back(pkg);
+               else
+                  changes.kept.push_back(pkg);
+               break;
 
-         case RPackage::FRemove:
-            if (flags & RPackage::FImportant)
-               essential.push_back(pkg);
-            else if(flags & RPackage::FPurge)
-	       toPurge.push_back(pkg);
-	    else
-               toRemove.push_back(pkg);
-            break;
+            case RPackage::FNewInstall:
+               changes.toInstall.push_back(pkg);
+               break;
+
+            case RPackage::FReInstall:
+               changes.toReInstall.push_back(pkg);
+               break;
+
+            case RPackage::FUpgrade:
+               changes.toUpgrade.push_back(pkg);
+               break;
+
+            case RPackage::FDowngrade:
+               changes.toDowngrade.push_back(pkg);
+               break;
+
+            case RPackage::FRemove:
+               if (flags & RPackage::FImportant)
+                  changes.essential.push_back(pkg);
+               else if (flags & RPackage::FPurge)
+                  changes.toPurge.push_back(pkg);
+               else
+                  changes.toRemove.push_back(pkg);
+               break;
+         }
+
+#ifdef WITH_APT_AUTH
+         switch (status) {
+            case RPackage::FNewInstall:
+            case RPackage::FReInstall:
+            case RPackage::FUpgrade:
+               if (!pkg->isTrusted())
+                  changes.unauthenticated++;
+               break;
+         }
+#endif
       }
+
+      changes.sizeChange = _cache->deps()->UsrSize();
+      _changeSetCache = _cacheGeneration;
+      _changeSetState = _stateGeneration;
    }
 
-   sort(kept.begin(), kept.end(), bla());
-   sort(toInstall.begin(), toInstall.end(), bla());
-   sort(toReInstall.begin(), toReInstall.end(), bla());
-   sort(toUpgrade.begin(), toUpgrade.end(), bla());
-   sort(essential.begin(), essential.end(), bla());
-   sort(toRemove.begin(), toRemove.end(), bla());
-   sort(toPurge.begin(), toPurge.end(), bla());
-   sort(held.begin(), held.end(), bla());
 #ifdef WITH_APT_AUTH
-   pkgAcquire Fetcher(NULL);
-   pkgPackageManager *PM = _system->CreatePM(_cache->deps());
-   if (!PM->GetArchives(&Fetcher, _cache->list(), _records)) {
-      delete PM;
-      return;
-   }
-   for (pkgAcquire::ItemIterator I = Fetcher.ItemsBegin(); 
-	I < Fetcher.ItemsEnd(); ++I) {
-      if (!(*I)->IsTrusted()) {
-         notAuthenticated.push_back(string((*I)->ShortDesc()));
+   if (withAuthentication && !changes.notAuthenticatedDone) {
+      changes.notAuthenticatedDone = true;
+      pkgAcquire Fetcher(NULL);
+      pkgPackageManager *PM = _system->CreatePM(_cache->deps());
+      if (PM->GetArchives(&Fetcher, _cache->list(), _records)) {
+         for (pkgAcquire::ItemIterator I = Fetcher.ItemsBegin();
+              I < Fetcher.ItemsEnd(); ++I) {
+            if (!(*I)->IsTrusted())
+               changes.notAuthenticated.push_back(string((*I)->ShortDesc()));
+         }
       }
+      delete PM;
    }
-   delete PM;
 #endif
-   sizeChange = deps->UsrSize();
+
+   return changes;
 }
 
 bool RPackageLister::updateCache(pkgAcquireStatus *status, string &error)
@@ -1617,28 +1780,15 @@ void RPackageLister::makeCommitLog()
    _logEntry = string("Commit Log for ") + string(ctime(&_logTime)) + string("\n");
    _logEntry.reserve(2*8192); // make it big by default 
 
-   vector<RPackage *> held;
-   vector<RPackage *> kept;
-   vector<RPackage *> essential;
-   vector<RPackage *> toInstall;
-   vector<RPackage *> toReInstall;
-   vector<RPackage *> toUpgrade;
-   vector<RPackage *> toRemove;
-   vector<RPackage *> toPurge;
-   vector<RPackage *> toDowngrade;
-#ifdef WITH_APT_AUTH
-   vector<string> notAuthenticated;
-#endif
-
-   double sizeChange;
-
-   getDetailedSummary(held, kept, essential,
-		      toInstall,toReInstall,toUpgrade, 
-		      toRemove, toPurge, toDowngrade, 
-#ifdef WITH_APT_AUTH
-		      notAuthenticated,
-#endif
-		      sizeChange);
+   // the same lists the summary showed
+   const RChangeSet &changes = getChangeSet();
+   const vector<RPackage *> &essential = changes.essential;
+   const vector<RPackage *> &toInstall = changes.toInstall;
+   const vector<RPackage *> &toReInstall = changes.toReInstall;
+   const vector<RPackage *> &toUpgrade = changes.toUpgrade;
+   const vector<RPackage *> &toRemove = changes.toRemove;
+   const vector<RPackage *> &toPurge = changes.toPurge;
+   const vector<RPackage *> &toDowngrade = changes.toDowngrade;
 
    if(essential.size() > 0) {
       //_logEntry += _("\n<b>Removed the following ESSENTIAL packages:</b>\n");
@@ -1763,7 +1913,9 @@ bool RPackageLister::cleanPackageCache(bool forceClean)
 
 void RPackageLister::refreshView()
 {
+   invalidateFlags();
    _selectedView->refresh();
+   _selectedView->setCurrent(_cacheGeneration, _stateGeneration);
 }
 
 bool RPackageLister::writeSelections(ostream &out, bool fullState)
@@ -1795,7 +1947,7 @@ bool RPackageLister::readSelections(istream &in)
       ACTION_PURGE
    };
    map<string, int> actionMap;
-   pkgDepCache::ActionGroup group(*_cache->deps());
+   RActionGroup group(this);
 
    while (in.eof() == false) {
 
@@ -1884,9 +2036,10 @@ bool RPackageLister::readSelections(istream &in)
       Fix.InstallProtect();
       Fix.Resolve(true);
 
-      // refresh all views
-      for (unsigned int i = 0; i != _views.size(); i++)
-         _views[i]->refresh();
+      // the views that depend on the package states are built again
+      // when they are looked at
+      invalidateFlags();
+      updateView(_selectedView);
 
    }
 
@@ -1966,15 +2119,321 @@ bool RPackageLister::addArchiveToCache(string archive, string &pkgname)
 }
 
 
+bool RPackageLister::snapshotOrder(const RPackageSnapshot &snapshot)
+{
+   if (snapshot.size() != _packages.size())
+      return false;
+
+   // _packagesIndex has the position of each package in _packages
+   // here; every package has to be in the snapshot exactly once
+   vector<RPackage *> sorted(_packages.size());
+   for (unsigned int i = 0; i < snapshot.size(); i++) {
+      unsigned int id = snapshot.id(i);
+      if (id >= _packagesIndex.size() || _packagesIndex[id] < 0)
+         return false;
+      sorted[i] = _packages[_packagesIndex[id]];
+      _packagesIndex[id] = -1;
+   }
+
+   // cheap compared to the sort it saves, and nothing else makes sure
+   // the order is still right
+   RPackageNameLess less;
+   for (unsigned int i = 1; i < sorted.size(); i++) {
+      if (less(sorted[i], sorted[i - 1]))
+         return false;
+   }
+
+   _packages.swap(sorted);
+   return true;
+}
+
+void RPackageLister::startSearchIndex()
+{
+   // the index is saved in the state dir, or in the users own dir
+   // when that is not writable; it is only good for the package cache
+   // it was built from
+   struct stat buf;
+   if (stat(_config->FindFile("Dir::Cache::pkgcache").c_str(), &buf) != 0)
+      buf.st_mtime = buf.st_size = 0;
+
+   vector<string> files;
+   files.push_back(RStateDir() + "/searchindex");
+   files.push_back(RConfDir() + "/searchindex");
+
+   RSearchIndex *old = NULL;
+   for (unsigned int i = 0; i < files.size(); i++) {
+      RSearchIndex *index = new RSearchIndex;
+      if (!index->load(files[i])) {
+         delete index;
+         continue;
+      }
+      if (index->isCurrent(buf.st_mtime, buf.st_size)) {
+         delete old;
+         _searchIndexer.setIndex(index);
+         return;
+      }
+      delete old;
+      old = index;
+   }
+
+   // an outdated index still saves reading the packages that did not
+   // change
+   RSearchIndexBuilder *builder =
+      new RSearchIndexBuilder(_packages, old, buf.st_mtime, buf.st_size);
+   _searchIndexer.start(builder, files,
+                        _config->FindB("Synaptic::BackgroundSearchIndex",
+                                       true));
+}
+
+RSearchIndex *RPackageLister::getSearchIndex(OpProgress *progress)
+{
+   return _searchIndexer.index(progress);
+}
+
+RDependencyGraph *RPackageLister::getDependencyGraph()
+{
+   if (!_depGraph.built() && _cache != NULL) {
+      _depGraph.build(_cache->deps());
+      if(_config->FindB("Debug::Synaptic::View",false))
+         clog << "dependency graph: " << _depGraph.size() << " packages, "
+              << _depGraph.edgeCount() << " edges" << endl;
+   }
+   return &_depGraph;
+}
+
+// the packages of the ids in name order, leaving out the ones that are
+// not shown (virtual packages)
+void RPackageLister::packagesOf(vector<uint32_t> &ids,
+                                vector<RPackage *> &result)
+{
+   vector<int> indexes;
+   indexes.reserve(ids.size());
+   for (unsigned int i = 0; i < ids.size(); i++) {
+      if (ids[i] < _packagesIndex.size() && _packagesIndex[ids[i]] != -1)
+         indexes.push_back(_packagesIndex[ids[i]]);
+   }
+   sort(indexes.begin(), indexes.end());
+
+   result.clear();
+   result.reserve(indexes.size());
+   for (unsigned int i = 0; i < indexes.size(); i++)
+      result.push_back(_packages[indexes[i]]);
+}
+
+void RPackageLister::getDependencyClosure(RPackage *pkg,
+                                          vector<RPackage *> &result)
+{
+   RDependencyGraph *graph = getDependencyGraph();
+   vector<uint32_t> start(1, pkg->id()), ids;
+   graph->closure(start, RDependencyGraph::All, true, ids);
+   packagesOf(ids, result);
+}
+
+void RPackageLister::getPulledInBy(RPackage *pkg, vector<RPackage *> &result)
+{
+   RDependencyGraph *graph = getDependencyGraph();
+   vector<uint32_t> start(1, pkg->id()), ids;
+   graph->reverseClosure(start, RDependencyGraph::All, true, ids);
+   packagesOf(ids, result);
+
+   // only the ones installed by hand
+   unsigned int n = 0;
+   for (unsigned int i = 0; i < result.size(); i++) {
+      if (!(result[i]->getFlags() & RPackage::FIsAuto))
+         result[n++] = result[i];
+   }
+   result.resize(n);
+}
+
+void RPackageLister::getRemovalCascade(RPackage *pkg,
+                                       vector<RPackage *> &result)
+{
+   // what only recommends it stays, and so does what has another
+   // installed alternative or provider
+   RDependencyGraph *graph = getDependencyGraph();
+   vector<uint32_t> start(1, pkg->id()), ids;
+   graph->removalClosure(start, RDependencyGraph::Hard, ids);
+   packagesOf(ids, result);
+}
+
+bool RPackageLister::getWhyInstalled(RPackage *pkg, vector<RPackage *> &path,
+                                     vector<int> &types)
+{
+   path.clear();
+   types.clear();
+
+   RDependencyGraph *graph = getDependencyGraph();
+   vector<bool> manual(graph->size(), false);
+   for (unsigned int i = 0; i < _packages.size(); i++) {
+      int flags = _packages[i]->getFlags();
+      if ((flags & RPackage::FInstalled) && !(flags & RPackage::FIsAuto))
+         manual[_packages[i]->id()] = true;
+   }
+
+   vector<uint32_t> ids;
+   vector<uint8_t> edgeTypes;
+   if (!graph->shortestPath(manual, pkg->id(), RDependencyGraph::All, true,
+                            ids, edgeTypes))
+      return false;
+
+   for (unsigned int i = 0; i < ids.size(); i++) {
+      if (ids[i] >= _packagesIndex.size() || _packagesIndex[ids[i]] == -1) {
+         path.clear();
+         return false;
+      }
+      path.push_back(_packages[_packagesIndex[ids[i]]]);
+   }
+   types.assign(edgeTypes.begin(), edgeTypes.end());
+   return true;
+}
+
+// matches the packages whose text contains all of the words
+struct wordMatcher : public RPackageMatcher {
+   const vector<string> &_words;
+   wordMatcher(const vector<string> &words) : _words(words) {}
+   bool match(RPackage *pkg, pkgRecords &records) {
+      RSearchIndex::Text text;
+      RSearchIndex::text(pkg, records, text);
+      for (unsigned int i = 0; i < _words.size(); i++) {
+         if (!RSearchIndex::contains(text, _words[i]))
+            return false;
+      }
+      return true;
+   }
+};
+
+bool RPackageLister::nativeSearch(string searchString)
+{
+   vector<string> words;
+   string::size_type start = 0;
+   while (start < searchString.size()) {
+      string::size_type end = searchString.find_first_of(" ,;", start);
+      if (end == string::npos)
+         end = searchString.size();
+      if (end > start)
+         words.push_back(searchString.substr(start, end - start));
+      start = end + 1;
+   }
+   if (words.empty())
+      return false;
+
+   // only the packages that may match are looked at, unless the words
+   // are too short for the index
+   vector<RPackage *> candidates;
+   RSearchIndex *index = getSearchIndex();
+   RPackageSet set;
+   if (index != NULL && index->candidates(words, set))
+      set.getPackages(_packages, candidates);
+   else
+      candidates = _packages;
+
+   // the same search as before (the table is refreshed after every
+   // change) only looks at packages it did not see yet; one that was
+   // only typed further skips the packages the last one looked at and
+   // did not match, as every old word is part of a new word. The
+   // description is the candidate's, so "Force Version" makes both
+   // stale, marking packages does not
+   RSearchCache::Entry *entry = findSearch(searchString,
+                                           RSearchCache::QuickSearch);
+   RSearchCache::Entry *last = NULL;
+   if (entry == NULL) {
+      if (!_lastSearch.empty() &&
+          searchString.compare(0, _lastSearch.size(), _lastSearch) == 0)
+         last = findSearch(_lastSearch, RSearchCache::QuickSearch);
+      entry = addSearch(searchString, RSearchCache::QuickSearch, true);
+   }
+
+   RPackageSet visible;
+   vector<RPackage *> unchecked;
+   for (unsigned int i = 0; i < candidates.size(); i++) {
+      RPackage *pkg = candidates[i];
+      if (!_selectedView->hasPackage(pkg))
+         continue;
+      if (entry->checked.contains(pkg)) {
+         if (entry->matched.contains(pkg))
+            visible.add(pkg);
+      } else if (last != NULL && last->checked.contains(pkg) &&
+                 !last->matched.contains(pkg)) {
+         entry->checked.add(pkg);
+      } else {
+         unchecked.push_back(pkg);
+      }
+   }
+
+   if (_config->FindB("Debug::Synaptic::View", false))
+      clog << "RPackageLister::nativeSearch: " << unchecked.size()
+           << " packages to look at for " << searchString
+           << (last != NULL ? " (refined)" : "") << endl;
+
+   wordMatcher matcher(words);
+   vector<RPackage *> matches;
+   RMatchPackages(unchecked, matcher, matches);
+   entry->checked.add(unchecked);
+   entry->matched.add(matches);
+   visible.add(matches);
+   _lastSearch = searchString;
+
+   _viewPackages.clear();
+   visible.getPackages(_packages, _viewPackages);
+
+   if (_sortMode != LIST_SORT_DEFAULT)
+      sortPackages(_sortMode);
+   else
+      updateViewPackagesIndex();
+   // the list is no longer what the selected view shows
+   _viewStateValid = false;
+   return true;
+}
+
 #ifdef WITH_EPT
 bool RPackageLister::limitBySearch(string searchString)
 {
    //cerr << "limitBySearch(): " << searchString << endl;
-    if (ept::axi::timestamp() == 0)
-        return false;
+   if (!usesXapianSearch())
+      return nativeSearch(searchString);
    return xapianSearch(searchString);
 }
 
+bool RPackageLister::usesXapianSearch()
+{
+   return ept::axi::timestamp() != 0;
+}
+
+bool RPackageLister::xapianShowResults(RSearchCache::Entry *entry,
+                                       int qualityCutoff)
+{
+   int top_percent = 0;
+   _viewPackages.clear();
+   for (unsigned int i = 0; i < entry->order.size(); i++) {
+      RPackage *pkg = _packages[entry->order[i]];
+      // Filter out results the view does not show
+      if (!_selectedView->hasPackage(pkg))
+         continue;
+
+      // Save the confidence interval of the top value, to use it as
+      // a reference to compute an adaptive quality cutoff
+      if (top_percent == 0)
+         top_percent = entry->percent[i];
+
+      // Stop producing if the quality goes below a cutoff point
+      if (entry->percent[i] < qualityCutoff * top_percent / 100)
+      {
+         cerr << "Discarding: " << entry->percent[i] << " over " << qualityCutoff * top_percent / 100 << endl;
+         break;
+      }
+
+      _viewPackages.push_back(pkg);
+   }
+   // re-apply sort criteria only if an explicit search is set
+   if (_sortMode != LIST_SORT_DEFAULT)
+       sortPackages(_sortMode);
+   else
+       updateViewPackagesIndex();
+   // the list is no longer what the selected view shows
+   _viewStateValid = false;
+   return true;
+}
+
 bool RPackageLister::xapianSearch(string unsplitSearchString)
 {
    //std::cerr << "RPackageLister::xapianSearch()" << std::endl;
@@ -1984,6 +2443,15 @@ bool RPackageLister::xapianSearch(string unsplitSearchString)
     if (ept::axi::timestamp() == 0) 
         return false;
 
+   // the ranking does not depend on the view or the package states,
+   // refreshing the table after a change does not query again
+   RSearchCache::Entry *entry = findSearch(unsplitSearchString,
+                                           RSearchCache::XapianSearch);
+   if (entry != NULL)
+      return xapianShowResults(entry, qualityCutoff);
+   // the string is changed for the query parser below
+   string searchKey = unsplitSearchString;
+
    try {
       int maxItems = _xapianDatabase->get_doccount();
       Xapian::Enquire enquire(*_xapianDatabase);
@@ -2038,36 +2506,24 @@ bool RPackageLister::xapianSearch(string unsplitSearchString)
          cerr << "matches estimated: " << matches.get_matches_estimated() << " results found" << endl;
       }
 
-      // Retrieve the results
-      int top_percent = 0;
-      _viewPackages.clear();
+      // Retrieve the results, keeping the ones apt knows
+      vector<unsigned int> order;
+      vector<int> percent;
       for (Xapian::MSetIterator i = matches.begin(); i != matches.end(); ++i)
       {
          RPackage* pkg = getPackage(i.get_document().get_data());
-         // Filter out results that apt doesn't know
-         if (!pkg || !_selectedView->hasPackage(pkg))
+         if (!pkg)
             continue;
-
-         // Save the confidence interval of the top value, to use it as
-         // a reference to compute an adaptive quality cutoff
-         if (top_percent == 0)
-            top_percent = i.get_percent();
-   
-         // Stop producing if the quality goes below a cutoff point
-         if (i.get_percent() < qualityCutoff * top_percent / 100)
-         {
-            cerr << "Discarding: " << i.get_percent() << " over " << qualityCutoff * top_percent / 100 << endl;
-            break;
-         }
-   
          if(_config->FindB("Debug::Synaptic::Xapian",false)) 
             cerr << i.get_rank() + 1 << ": " << i.get_percent() << "% docid=" << *i << "	[" << i.get_document().get_data() << "]" << endl;
-         _viewPackages.push_back(pkg);
-         }
-      // re-apply sort criteria only if an explicit search is set
-      if (_sortMode != LIST_SORT_DEFAULT)
-          sortPackages(_sortMode);
-      return true;
+         order.push_back(pkg->index());
+         percent.push_back(i.get_percent());
+      }
+
+      entry = addSearch(searchKey, RSearchCache::XapianSearch, false);
+      entry->order.swap(order);
+      entry->percent.swap(percent);
+      return xapianShowResults(entry, qualityCutoff);
    } catch (const Xapian::Error & error) {
       /* We are here if a Xapian call failed. The main cause is a parser exception.
        * The error message is always in English currently. 
@@ -2086,6 +2542,11 @@ bool RPackageLister::xapianSearch(string unsplitSearchString)
 }
 #else
 bool RPackageLister::limitBySearch(string searchString)
+{
+   return nativeSearch(searchString);
+}
+
+bool RPackageLister::usesXapianSearch()
 {
    return false;
 }
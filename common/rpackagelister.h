@@ -33,6 +33,7 @@
 #include <map>
 #include <set>
 #include <regex.h>
+#include <stdint.h>
 #include <apt-pkg/depcache.h>
 #include <apt-pkg/acquire.h>
 #include <apt-pkg/progress.h>
@@ -43,6 +44,13 @@
 
 #include "rpackagecache.h"
 #include "rpackage.h"
+#include "rpackagecolumns.h"
+#include "rsearchindexer.h"
+#include "rsearchcache.h"
+#include "rrecordcache.h"
+#include "rpackagesnapshot.h"
+#include "rpackagearena.h"
+#include "rdepgraph.h"
 #include "rpackagestatus.h"
 #include "rpackageview.h"
 #include "ruserdialog.h"
@@ -80,24 +88,35 @@ class RCacheObserver {
    virtual void notifyCachePostChange() = 0;
 };
 
-// base sort class
-// for a example use see sortPackages()
-template<class T>
-class sortFunc {
- protected:
-   bool _ascent;
-   T cmp;
- public:
-   sortFunc(bool ascent) : _ascent(ascent) {}
-   bool operator() (RPackage *x, RPackage *y) {
-      if(_ascent)
-	 return cmp(x,y);
-      else
-	 return cmp(y,x);
+// what the marked changes do to each package, every list in name
+// order, see RPackageLister::getChangeSet()
+struct RChangeSet {
+   vector<RPackage *> held;
+   vector<RPackage *> kept;
+   vector<RPackage *> essential;     // removed although important
+   vector<RPackage *> toInstall;
+   vector<RPackage *> toReInstall;
+   vector<RPackage *> toUpgrade;
+   vector<RPackage *> toRemove;
+   vector<RPackage *> toPurge;
+   vector<RPackage *> toDowngrade;
+
+   // packages installed in some way from an untrusted origin
+   int unauthenticated;
+   // the downloads that can not be authenticated, only filled in when
+   // asked for
+   vector<string> notAuthenticated;
+   bool notAuthenticatedDone;
+
+   double sizeChange;
+
+   // all removals, the essential ones included
+   int removeCount() const {
+      return essential.size() + toRemove.size() + toPurge.size();
    }
+   void clear();
 };
 
-
 class RPackageLister {
 
    protected:
@@ -113,12 +132,73 @@ class RPackageLister {
 
 
    // Other members.
+   // where the packages are, they are not deleted one by one
+   RPackageArena _arena;
+
+   // sorted by name, so _packagesIndex is also the name rank
    vector<RPackage *> _packages;
    vector<int> _packagesIndex;
 
    vector<RPackage *> _viewPackages;
    vector<int> _viewPackagesIndex;
 
+   // what the package list shows, by package id
+   RPackageColumns _columns;
+
+   // puts _packages in the order of a snapshot, false if that does not
+   // fit the packages of the cache
+   bool snapshotOrder(const RPackageSnapshot &snapshot);
+
+   // for the searches without xapian, built in the background
+   RSearchIndexer _searchIndexer;
+   void startSearchIndex();
+
+   // the results of recent searches; a quick search that extends the
+   // last one only looks at what that one matched
+   RSearchCache _searchCache;
+   string _lastSearch;
+
+   // the fields of the records shown last
+   RRecordCache _recordCache;
+
+   // the marked changes, worked out once for each package state
+   RChangeSet _changeSet;
+   unsigned int _changeSetCache;
+   unsigned int _changeSetState;
+
+   // built the first time it is asked for after opening the cache
+   RDependencyGraph _depGraph;
+   void packagesOf(vector<uint32_t> &ids, vector<RPackage *> &result);
+
+   // refreshes a view not built for the current cache and package
+   // states, so the views nobody looks at are never built
+   void updateView(RPackageView *view);
+
+   // openCache() calls and package state changes so far
+   unsigned int _cacheGeneration;
+   unsigned int _stateGeneration;
+   // changes of a candidate version since the cache was opened, what
+   // is read from the candidate's record or dependencies only changes
+   // with these, not with every mark
+   unsigned int _candidateGeneration;
+
+   // RPackage::getStateFlags() of all packages indexed by package id,
+   // recomputed in one go the first time they are read after a change
+   vector<uint32_t> _flagCache;
+   bool _flagCacheDirty;
+   void refreshFlags();
+
+   // flags of all packages (indexed like _packages) at the time
+   // _viewPackages was last brought up to date, used to find out
+   // which packages a change really touched
+   vector<int> _viewState;
+   bool _viewStateValid;
+
+   // the packages the last notifyPostChange() found changed, only
+   // known if the view was updated incrementally
+   vector<RPackage *> _lastChanges;
+   bool _lastChangesValid;
+
    // this is what we feed to the views as "all packages" to avoid
    // to show all the multiarch versions by default, the user can
    // turn that off with a config option
@@ -141,6 +221,10 @@ class RPackageLister {
 
    // helper for the limitBySearch() code
    bool xapianSearch(string searchString);
+#ifdef WITH_EPT
+   bool xapianShowResults(RSearchCache::Entry *entry, int qualityCutoff);
+#endif
+   bool nativeSearch(string searchString);
 
    public:
 
@@ -171,8 +255,16 @@ class RPackageLister {
 
 #ifdef HAVE_RPM
    typedef pkgDepCache::State pkgState;
+   typedef pkgState undoState;
 #else
    typedef vector<int> pkgState;
+   // what one action changed, by package index
+   struct flagChange {
+      unsigned int index;
+      int oldFlags;
+      int newFlags;
+   };
+   typedef vector<flagChange> undoState;
 #endif
 
    private:
@@ -186,6 +278,11 @@ class RPackageLister {
    bool lockPackageCache(FileFd &lock);
 
    void sortPackages(vector<RPackage *> &packages,listSortMode mode);
+   void updateViewPackagesIndex();
+
+   // incremental update of the view after a package state change
+   bool getChangedPackages(vector<RPackage *> &changed);
+   bool refreshChangedPackages(const vector<RPackage *> &changed);
 
    struct {
       char *pattern;
@@ -205,19 +302,29 @@ class RPackageLister {
    time_t _logTime;
 
    // undo/redo stuff
-   list<pkgState> undoStack;
-   list<pkgState> redoStack;
+   list<undoState> undoStack;
+   list<undoState> redoStack;
+#ifndef HAVE_RPM
+   // marks pkg the way flags say, if it is not already
+   void markFlags(RPackage *pkg, int flags, bool autoInst);
+   // brings the packages of changes back to the old or the new flags
+   void applyChanges(const undoState &changes, bool old);
+#endif
 
    public:
    // limit what the current view displays
    bool limitBySearch(string searchString);
+   // true if limitBySearch() asks xapian, which can not narrow the
+   // results of the search before down
+   bool usesXapianSearch();
 
    // clean files older than "Synaptic::delHistory"
    void cleanCommitLog();
 
-   void sortPackages(listSortMode mode) {
-      sortPackages(_viewPackages, mode);
-   }
+   void sortPackages(listSortMode mode);
+
+   // the key sortPackages() orders the packages by
+   uint64_t sortKey(RPackage *pkg, listSortMode mode);
 
    void setView(unsigned int index);
    vector<string> getViews();
@@ -249,36 +356,41 @@ class RPackageLister {
    int getPackageIndex(RPackage *pkg);
    int getViewPackageIndex(RPackage *pkg);
 
+   // packages changed by the last notifyPostChange(), false if unknown
+   bool getLastChanges(vector<RPackage *> &changed) {
+      if (!_lastChangesValid)
+         return false;
+      changed = _lastChanges;
+      return true;
+   }
+
+   // state flags of the package with the given id, see RPackage::getFlags()
+   uint32_t getCachedFlags(unsigned int id) {
+      if (_flagCacheDirty)
+         refreshFlags();
+      return _flagCache[id];
+   }
+   // must be called whenever the depcache state was changed
+   void invalidateFlags() { _flagCacheDirty = true; _stateGeneration++; }
+   // must be called whenever a candidate version was changed
+   void invalidateCandidates() { _candidateGeneration++; invalidateFlags(); }
+
    int packagesSize() { return _packages.size(); }
    int viewPackagesSize() { return _updating ? 0 : _viewPackages.size(); }
 
    void getStats(int &installed, int &broken, int &toInstall,
 		 int &toRemove, double &sizeChange);
 
-   void getSummary(int &held, int &kept, int &essential,
-                   int &toInstall, int &toReInstall, int &toUpgrade,
-		   int &toRemove,  int &toDowngrade,
-		   int &unAuthenticated,  double &sizeChange);
-
-
-   void getDetailedSummary(vector<RPackage *> &held,
-                           vector<RPackage *> &kept,
-                           vector<RPackage *> &essential,
-                           vector<RPackage *> &toInstall,
-                           vector<RPackage *> &toReInstall,
-                           vector<RPackage *> &toUpgrade,
-                           vector<RPackage *> &toRemove,
-                           vector<RPackage *> &toPurge,
-                           vector<RPackage *> &toDowngrade,
-#ifdef WITH_APT_AUTH
-			   vector<string> &notAuthenticated,
-#endif
-                           double &sizeChange);
+   // all marked changes, from one pass over the packages that is only
+   // done again after the package states changed; the downloads that
+   // can not be authenticated are only looked for with
+   // withAuthentication. Valid until the next package state change.
+   const RChangeSet &getChangeSet(bool withAuthentication = false);
 
    void getDownloadSummary(int &dlCount, double &dlSize);
 
+   // keeps what changed since state was saved, for undo
    void saveUndoState(pkgState &state);
-   void saveUndoState();
    void undo();
    void redo();
    void saveState(pkgState &state);
@@ -348,6 +460,45 @@ class RPackageLister {
    bool writeSelections(ostream &out, bool fullState);
 
    RPackageCache* getCache() { return _cache; }
+   // bumped when the cache is opened again and when package states change
+   unsigned int cacheGeneration() { return _cacheGeneration; }
+   unsigned int stateGeneration() { return _stateGeneration; }
+   unsigned int candidateGeneration() { return _candidateGeneration; }
+   RPackageColumns* getColumns() { return &_columns; }
+   RRecordCache* getRecordCache() { return &_recordCache; }
+   RPackageStatus* getPackageStatus() { return &_pkgStatus; }
+
+   // the dependency graph of the cache, see RDependencyGraph
+   RDependencyGraph* getDependencyGraph();
+   // the installed packages pkg pulls in, directly or not
+   void getDependencyClosure(RPackage *pkg, vector<RPackage *> &result);
+   // the manually installed packages that pull pkg in
+   void getPulledInBy(RPackage *pkg, vector<RPackage *> &result);
+   // the installed packages that go away with pkg, as they depend on it
+   // and no other installed alternative or provider is left
+   void getRemovalCascade(RPackage *pkg, vector<RPackage *> &result);
+   // one of the shortest chains of dependencies from a manually
+   // installed package down to pkg, with the RDependencyGraph::EdgeType
+   // of each link; false if nothing installed by hand needs pkg
+   bool getWhyInstalled(RPackage *pkg, vector<RPackage *> &path,
+                        vector<int> &types);
+   // NULL while there is no index yet, valid until the next call
+   RSearchIndex* getSearchIndex(OpProgress *progress = NULL);
+
+   // cached search results of the current cache and candidates
+   RSearchCache::Entry *findSearch(const string &query, int type) {
+      return _searchCache.find(query, type, _cacheGeneration,
+                               _candidateGeneration);
+   }
+   RSearchCache::Entry *addSearch(const string &query, int type,
+                                  bool dependsOnCandidate) {
+      return _searchCache.add(query, type, _cacheGeneration,
+                              _candidateGeneration, dependsOnCandidate);
+   }
+   // false if the search index is not being built
+   bool getSearchIndexProgress(unsigned int &done, unsigned int &total) {
+      return _searchIndexer.getProgress(done, total);
+   }
 #ifdef WITH_EPT
    Xapian::Database* xapiandatabase() { return _xapianDatabase; }
    bool xapianIndexNeedsUpdate();
@@ -358,6 +509,22 @@ class RPackageLister {
    ~RPackageLister();
 };
 
+// use this instead of pkgDepCache::ActionGroup, it takes care of the
+// flag cache once the group is done
+class RActionGroup {
+   pkgDepCache::ActionGroup _group;
+   RPackageLister *_lister;
+
+ public:
+   RActionGroup(RPackageLister *lister)
+      : _group(*lister->getCache()->deps()), _lister(lister) {}
+   ~RActionGroup() {
+      // the release runs the delayed MarkAndSweep()
+      _group.release();
+      _lister->invalidateFlags();
+   }
+};
+
 
 #endif
 
@@ -0,0 +1,86 @@
+/* rpackageset.cc - set of packages as a bitmap
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include "rpackageset.h"
+
+void RPackageSet::add(const vector<RPackage *> &pkgs)
+{
+   for (unsigned int i = 0; i < pkgs.size(); i++) {
+      if (pkgs[i] != NULL)
+         add(pkgs[i]);
+   }
+}
+
+bool RPackageSet::empty() const
+{
+   for (unsigned int i = 0; i < _bits.size(); i++) {
+      if (_bits[i] != 0)
+         return false;
+   }
+   return true;
+}
+
+unsigned int RPackageSet::count() const
+{
+   unsigned int n = 0;
+   for (unsigned int i = 0; i < _bits.size(); i++)
+      n += __builtin_popcountl(_bits[i]);
+   return n;
+}
+
+void RPackageSet::intersect(const RPackageSet &other)
+{
+   if (_bits.size() > other._bits.size())
+      _bits.resize(other._bits.size());
+   for (unsigned int i = 0; i < _bits.size(); i++)
+      _bits[i] &= other._bits[i];
+}
+
+void RPackageSet::unite(const RPackageSet &other)
+{
+   if (_bits.size() < other._bits.size())
+      _bits.resize(other._bits.size(), 0);
+   for (unsigned int i = 0; i < other._bits.size(); i++)
+      _bits[i] |= other._bits[i];
+}
+
+void RPackageSet::subtract(const RPackageSet &other)
+{
+   unsigned int n = _bits.size();
+   if (n > other._bits.size())
+      n = other._bits.size();
+   for (unsigned int i = 0; i < n; i++)
+      _bits[i] &= ~other._bits[i];
+}
+
+void RPackageSet::getPackages(const vector<RPackage *> &packages,
+                              vector<RPackage *> &pkgs) const
+{
+   for (unsigned int i = 0; i < _bits.size(); i++) {
+      unsigned long word = _bits[i];
+      while (word != 0) {
+         unsigned int index = i * WordBits + __builtin_ctzl(word);
+         if (index < packages.size())
+            pkgs.push_back(packages[index]);
+         // drop the lowest bit
+         word &= word - 1;
+      }
+   }
+}
+
+// vim:ts=3:sw=3:et
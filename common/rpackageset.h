@@ -0,0 +1,78 @@
+/* rpackageset.h - set of packages as a bitmap
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RPACKAGESET_H
+#define RPACKAGESET_H
+
+#include <vector>
+
+#include "rpackage.h"
+
+using namespace std;
+
+// A set of packages, one bit per RPackage::index(). Since the index is
+// the name order, the packages come out of the set sorted by name.
+// The bitmap grows as packages are added, sets of different size can
+// be combined.
+class RPackageSet {
+ protected:
+   vector<unsigned long> _bits;
+
+   static const unsigned int WordBits = sizeof(unsigned long) * 8;
+
+ public:
+   bool test(unsigned int index) const {
+      unsigned int word = index / WordBits;
+      return word < _bits.size() && ((_bits[word] >> (index % WordBits)) & 1);
+   }
+   void set(unsigned int index) {
+      unsigned int word = index / WordBits;
+      if (word >= _bits.size())
+         _bits.resize(word + 1, 0);
+      _bits[word] |= 1UL << (index % WordBits);
+   }
+   void reset(unsigned int index) {
+      unsigned int word = index / WordBits;
+      if (word < _bits.size())
+         _bits[word] &= ~(1UL << (index % WordBits));
+   }
+
+   bool contains(RPackage *pkg) const { return test(pkg->index()); }
+   void add(RPackage *pkg) { set(pkg->index()); }
+   void remove(RPackage *pkg) { reset(pkg->index()); }
+
+   void add(const vector<RPackage *> &pkgs);
+
+   void clear() { _bits.clear(); }
+   bool empty() const;
+   unsigned int count() const;
+
+   // these work a word at a time
+   void intersect(const RPackageSet &other);
+   void unite(const RPackageSet &other);
+   void subtract(const RPackageSet &other);
+
+   // appends the members to pkgs in index order, packages is the
+   // list the indexes refer to
+   void getPackages(const vector<RPackage *> &packages,
+                    vector<RPackage *> &pkgs) const;
+};
+
+#endif
+
+// vim:ts=3:sw=3:et
@@ -0,0 +1,282 @@
+/* rpackagesnapshot.cc - what opening the cache works out, saved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <clocale>
+#include <unistd.h>
+
+#include <apt-pkg/fileutl.h>
+#include <apt-pkg/error.h>
+
+#include "rpackagesnapshot.h"
+
+// what is at the start of a saved snapshot, followed by the ids, the
+// candidates, the section, arch, component and origin string ids, the
+// string offsets, the flags and the strings
+struct snapshotHeader {
+   char magic[8];
+   uint32_t version;
+   uint32_t count;
+   uint64_t cacheMtime;
+   uint64_t cacheSize;
+   uint32_t packageCount;
+   uint32_t locale;
+   uint32_t stringCount;
+   uint32_t stringsSize;
+};
+
+static const char SnapshotMagic[8] = "SYNSNP\n";
+static const uint32_t SnapshotVersion = 1;
+
+RPackageSnapshot::RPackageSnapshot()
+   : _ids(NULL), _flags(NULL), _section(NULL), _arch(NULL),
+     _component(NULL), _origin(NULL), _candidate(NULL),
+     _stringOffsets(NULL), _strings(NULL), _count(0), _stringCount(0),
+     _stringsSize(0), _packageCount(0), _cacheMtime(0), _cacheSize(0),
+     _locale(0), _map(NULL)
+{
+}
+
+RPackageSnapshot::~RPackageSnapshot()
+{
+   clear();
+}
+
+void RPackageSnapshot::clear()
+{
+   delete _map;
+   _map = NULL;
+   _idsV.clear();
+   _flagsV.clear();
+   _sectionV.clear();
+   _archV.clear();
+   _componentV.clear();
+   _originV.clear();
+   _candidateV.clear();
+   _stringOffsetsV.clear();
+   _stringsV.clear();
+   _ids = _section = _arch = _component = _origin = _candidate = NULL;
+   _stringOffsets = NULL;
+   _flags = NULL;
+   _strings = NULL;
+   _count = _stringCount = _stringsSize = _packageCount = 0;
+}
+
+// the column strings include translated ones ("Unknown" section)
+uint32_t RPackageSnapshot::localeHash()
+{
+   uint32_t hash = 2166136261U;
+   const char *locale = setlocale(LC_MESSAGES, NULL);
+   for (; locale != NULL && *locale != 0; locale++)
+      hash = (hash ^ (unsigned char)*locale) * 16777619U;
+   return hash;
+}
+
+void RPackageSnapshot::build(pkgDepCache *deps,
+                             const vector<RPackage *> &packages,
+                             RPackageColumns &columns, uint64_t cacheMtime,
+                             uint64_t cacheSize)
+{
+   clear();
+
+   _count = packages.size();
+   _idsV.resize(_count);
+   _flagsV.resize(_count, 0);
+   _sectionV.resize(_count);
+   _archV.resize(_count);
+   _componentV.resize(_count);
+   _originV.resize(_count);
+   _candidateV.resize(_count);
+   for (unsigned int i = 0; i < _count; i++) {
+      RPackage *pkg = packages[i];
+      _idsV[i] = pkg->id();
+      if (pkg->isMultiArchDuplicate())
+         _flagsV[i] |= MultiArchDuplicate;
+      _sectionV[i] = columns.sectionId(pkg);
+      _archV[i] = columns.archId(pkg);
+      _componentV[i] = columns.componentId(pkg);
+      _originV[i] = columns.originId(pkg);
+      pkgCache::VerIterator cand =
+         (*deps)[*pkg->package()].CandidateVerIter(*deps);
+      _candidateV[i] = cand.end() ? 0 : cand->ID + 1;
+   }
+
+   // the strings after the ids were taken, so that they are all there
+   _stringCount = columns.stringCount();
+   _stringOffsetsV.resize(_stringCount);
+   for (unsigned int i = 0; i < _stringCount; i++) {
+      const string &str = columns.getString(i);
+      _stringOffsetsV[i] = _stringsV.size();
+      _stringsV.insert(_stringsV.end(), str.begin(), str.end());
+      _stringsV.push_back(0);
+   }
+
+   _stringsSize = _stringsV.size();
+   _packageCount = deps->Head().PackageCount;
+   _cacheMtime = cacheMtime;
+   _cacheSize = cacheSize;
+   _locale = localeHash();
+
+   _ids = &_idsV[0];
+   _flags = &_flagsV[0];
+   _section = &_sectionV[0];
+   _arch = &_archV[0];
+   _component = &_componentV[0];
+   _origin = &_originV[0];
+   _candidate = &_candidateV[0];
+   _stringOffsets = &_stringOffsetsV[0];
+   _strings = &_stringsV[0];
+}
+
+bool RPackageSnapshot::isCurrent(uint64_t cacheMtime, uint64_t cacheSize,
+                                 unsigned int packageCount) const
+{
+   return _ids != NULL && _cacheMtime == cacheMtime &&
+          _cacheSize == cacheSize && _packageCount == packageCount &&
+          _locale == localeHash();
+}
+
+bool RPackageSnapshot::load(const string &file)
+{
+   if (!FileExists(file))
+      return false;
+
+   FileFd File(file, FileFd::ReadOnly);
+   MMap *map = NULL;
+   if (!_error->PendingError())
+      map = new MMap(File, MMap::ReadOnly);
+   if (_error->PendingError()) {
+      // an unreadable snapshot is made again, nothing to complain about
+      _error->Discard();
+      delete map;
+      return false;
+   }
+
+   const char *data = (const char *)map->Data();
+   uint64_t size = map->Size();
+   const snapshotHeader *header = (const snapshotHeader *)data;
+   if (size < sizeof(snapshotHeader) ||
+       memcmp(header->magic, SnapshotMagic, sizeof(header->magic)) != 0 ||
+       header->version != SnapshotVersion || header->count == 0 ||
+       header->stringCount == 0) {
+      delete map;
+      return false;
+   }
+
+   uint64_t count = header->count;
+   uint64_t needed = sizeof(snapshotHeader) +
+                     (6 * count + header->stringCount) * sizeof(uint32_t) +
+                     count + header->stringsSize;
+   if (size < needed) {
+      delete map;
+      return false;
+   }
+
+   clear();
+   _map = map;
+   const uint32_t *p = (const uint32_t *)(data + sizeof(snapshotHeader));
+   _ids = p;
+   p += count;
+   _candidate = p;
+   p += count;
+   _section = p;
+   p += count;
+   _arch = p;
+   p += count;
+   _component = p;
+   p += count;
+   _origin = p;
+   p += count;
+   _stringOffsets = p;
+   p += header->stringCount;
+   _flags = (const uint8_t *)p;
+   _strings = (const char *)_flags + count;
+
+   _count = count;
+   _stringCount = header->stringCount;
+   _stringsSize = header->stringsSize;
+   _packageCount = header->packageCount;
+   _cacheMtime = header->cacheMtime;
+   _cacheSize = header->cacheSize;
+   _locale = header->locale;
+
+   // everything that is looked up has to be in there
+   for (unsigned int i = 0; i < _count; i++) {
+      if (_ids[i] >= _packageCount || _section[i] >= _stringCount ||
+          _arch[i] >= _stringCount || _component[i] >= _stringCount ||
+          _origin[i] >= _stringCount) {
+         clear();
+         return false;
+      }
+   }
+   for (unsigned int i = 0; i < _stringCount; i++) {
+      if (_stringOffsets[i] >= _stringsSize) {
+         clear();
+         return false;
+      }
+   }
+   if (_stringsSize == 0 || _strings[_stringsSize - 1] != 0) {
+      clear();
+      return false;
+   }
+   return true;
+}
+
+bool RPackageSnapshot::save(const string &file) const
+{
+   if (_ids == NULL)
+      return false;
+
+   snapshotHeader header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, SnapshotMagic, sizeof(header.magic));
+   header.version = SnapshotVersion;
+   header.count = _count;
+   header.cacheMtime = _cacheMtime;
+   header.cacheSize = _cacheSize;
+   header.packageCount = _packageCount;
+   header.locale = _locale;
+   header.stringCount = _stringCount;
+   header.stringsSize = _stringsSize;
+
+   // written next to it and renamed, so a reader never sees half of it
+   string tmp = file + ".new";
+   ofstream out(tmp.c_str(), ios::binary);
+   if (!out)
+      return false;
+   out.write((const char *)&header, sizeof(header));
+   out.write((const char *)_ids, _count * sizeof(uint32_t));
+   out.write((const char *)_candidate, _count * sizeof(uint32_t));
+   out.write((const char *)_section, _count * sizeof(uint32_t));
+   out.write((const char *)_arch, _count * sizeof(uint32_t));
+   out.write((const char *)_component, _count * sizeof(uint32_t));
+   out.write((const char *)_origin, _count * sizeof(uint32_t));
+   out.write((const char *)_stringOffsets, _stringCount * sizeof(uint32_t));
+   out.write((const char *)_flags, _count);
+   out.write(_strings, header.stringsSize);
+   out.close();
+   if (!out || rename(tmp.c_str(), file.c_str()) != 0) {
+      unlink(tmp.c_str());
+      return false;
+   }
+   return true;
+}
+
+// vim:ts=3:sw=3:et
@@ -0,0 +1,120 @@
+/* rpackagesnapshot.h - what opening the cache works out, saved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RPACKAGESNAPSHOT_H
+#define RPACKAGESNAPSHOT_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include <apt-pkg/mmap.h>
+#include <apt-pkg/depcache.h>
+
+#include "rpackage.h"
+#include "rpackagecolumns.h"
+
+using namespace std;
+
+// The part of RPackageLister::openCache() that only depends on the
+// package cache: the packages in name order, which of them are hidden
+// multiarch duplicates, and the interned strings of the package list
+// columns. It is saved after the cache was opened and mapped back in
+// on the next start, as long as the cache did not change, which saves
+// sorting the packages and interning the strings again.
+//
+// Everything is by position in name order.
+class RPackageSnapshot {
+ public:
+   enum {
+      MultiArchDuplicate = 1 << 0
+   };
+
+ protected:
+   // these point either into the vectors or into the mapped file
+   const uint32_t *_ids;
+   const uint8_t *_flags;
+   const uint32_t *_section;
+   const uint32_t *_arch;
+   const uint32_t *_component;
+   const uint32_t *_origin;
+   // the id of the candidate version + 1, 0 for none; component and
+   // origin are only good for that version
+   const uint32_t *_candidate;
+   const uint32_t *_stringOffsets;
+   const char *_strings;
+
+   uint32_t _count;
+   uint32_t _stringCount;
+   uint32_t _stringsSize;
+   uint32_t _packageCount;
+   uint64_t _cacheMtime;
+   uint64_t _cacheSize;
+   uint32_t _locale;
+
+   vector<uint32_t> _idsV;
+   vector<uint8_t> _flagsV;
+   vector<uint32_t> _sectionV;
+   vector<uint32_t> _archV;
+   vector<uint32_t> _componentV;
+   vector<uint32_t> _originV;
+   vector<uint32_t> _candidateV;
+   vector<uint32_t> _stringOffsetsV;
+   vector<char> _stringsV;
+   MMap *_map;
+
+   static uint32_t localeHash();
+
+ public:
+   // packages in name order, with the columns built for them
+   void build(pkgDepCache *deps, const vector<RPackage *> &packages,
+              RPackageColumns &columns, uint64_t cacheMtime,
+              uint64_t cacheSize);
+
+   void clear();
+   bool isCurrent(uint64_t cacheMtime, uint64_t cacheSize,
+                  unsigned int packageCount) const;
+
+   bool load(const string &file);
+   bool save(const string &file) const;
+
+   unsigned int size() const { return _count; }
+   unsigned int id(unsigned int i) const { return _ids[i]; }
+   bool isMultiArchDuplicate(unsigned int i) const {
+      return _flags[i] & MultiArchDuplicate;
+   }
+
+   unsigned int section(unsigned int i) const { return _section[i]; }
+   unsigned int arch(unsigned int i) const { return _arch[i]; }
+   unsigned int component(unsigned int i) const { return _component[i]; }
+   unsigned int origin(unsigned int i) const { return _origin[i]; }
+   unsigned int candidate(unsigned int i) const { return _candidate[i]; }
+
+   // the strings the ids above refer to, 0 is the empty string
+   unsigned int stringCount() const { return _stringCount; }
+   const char *getString(unsigned int id) const {
+      return _strings + _stringOffsets[id];
+   }
+
+   RPackageSnapshot();
+   ~RPackageSnapshot();
+};
+
+#endif
+
+// vim:ts=3:sw=3:et
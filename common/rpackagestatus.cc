@@ -28,7 +28,10 @@
 
 #include <apt-pkg/tagfile.h>
 #include <apt-pkg/strutl.h>
+#include <algorithm>
+
 #include "rpackagestatus.h"
+#include "rpackagelister.h"
 
 // init the static release array so that we need to
 // run lsb_release only once
@@ -63,7 +66,8 @@ void RPackageStatus::init()
    memcpy(PackageStatusLongString, status_long, sizeof(status_long));
 
 
-   // check for unsupported stuff
+   // check for unsupported stuff, anything worked out before is stale
+   _supportLister = NULL;
    if(_config->FindB("Synaptic::mark-unsupported", true)) {
       string s, labels, origin, components;
       markUnsupported = true;
@@ -102,44 +106,129 @@ void RPackageStatus::init()
    } 
 }
 
-bool RPackageStatus::isSupported(RPackage *pkg) 
+// the tables are for the packages and files of one cache
+void RPackageStatus::resetSupport(RPackageLister *lister)
 {
-   bool res = true;
+   if (_supportLister == lister &&
+       _supportGeneration == lister->cacheGeneration())
+      return;
 
-   if(markUnsupported) {
-      bool sc, sl, so;
+   pkgDepCache *deps = lister->getCache()->deps();
+   _supportLister = lister;
+   _supportGeneration = lister->cacheGeneration();
+   _fileSupport.assign(deps->Head().PackageFileCount, Unknown);
+   packageSupport unknown = { 0, Unknown };
+   _packageSupport.assign(deps->Head().PackageCount, unknown);
+#ifdef WITH_APT_AUTH
+   _componentSupport.clear();
+#else
+   _componentSupport.assign(deps->Head().PackageFileCount, Unknown);
+#endif
+}
 
-      sc=sl=so=false;
+bool RPackageStatus::supportedComponent(const string &component)
+{
+   return find(supportedComponents.begin(), supportedComponents.end(),
+               component) != supportedComponents.end();
+}
 
-      string component = pkg->component();
-      string label = pkg->label();
-      string origin = pkg->origin();
+#ifdef WITH_APT_AUTH
+// the apt-secure patch breaks File.Component, it comes from the
+// section, so it is worked out once for each section
+bool RPackageStatus::componentSupported(RPackage *pkg)
+{
+   resetSupport(pkg->_lister);
+   unsigned int id = pkg->_lister->getColumns()->sectionId(pkg);
+   if (id >= _componentSupport.size())
+      _componentSupport.resize(id + 1, Unknown);
+   if (_componentSupport[id] == Unknown)
+      _componentSupport[id] =
+         supportedComponent(pkg->component()) ? Supported : Unsupported;
+   return _componentSupport[id] == Supported;
+}
+#else
+bool RPackageStatus::fileComponentSupported(pkgCache::PkgFileIterator File)
+{
+   if (File->ID >= _componentSupport.size())
+      return false;
+   if (_componentSupport[File->ID] == Unknown)
+      _componentSupport[File->ID] =
+         supportedComponent(File.Component() ? File.Component() : "") ?
+         Supported : Unsupported;
+   return _componentSupport[File->ID] == Supported;
+}
 
-      for(unsigned int i=0;i<supportedComponents.size();i++) {
-	 if(supportedComponents[i] == component) {
-	    sc = true;
-	    break;
-	 }
-      }
-      for(unsigned int i=0;i<supportedLabels.size();i++) {
-	 if(supportedLabels[i] == label) {
-	    sl = true;
-	    break;
-	 }
-      }
-      for(unsigned int i=0;i<supportedOrigins.size();i++) {
-	 if(supportedOrigins[i] == origin) {
-	    so = true;
-	    break;
-	 }
-      }
+// the component of the package file of the candidate
+bool RPackageStatus::componentSupported(RPackage *pkg)
+{
+   resetSupport(pkg->_lister);
+   pkgDepCache *deps = pkg->_lister->getCache()->deps();
+   pkgCache::VerIterator Ver = (*deps)[*pkg->package()].CandidateVerIter(*deps);
+   if (Ver.end() || Ver.FileList().end())
+      return supportedComponent("");
+   return fileComponentSupported(Ver.FileList().File());
+}
+#endif
 
-      res = (sc & sl & so & pkg->isTrusted());
-   }
+// the label and the origin (and without apt-secure the component) of
+// a package file, which are the same for all of its packages
+bool RPackageStatus::fileSupported(pkgCache::PkgFileIterator File)
+{
+   if (File->ID >= _fileSupport.size())
+      return false;
+   if (_fileSupport[File->ID] != Unknown)
+      return _fileSupport[File->ID] == Supported;
+
+   string label = File.Label() ? File.Label() : "";
+   string origin = File.Origin() ? File.Origin() : "";
+   bool res =
+      find(supportedLabels.begin(), supportedLabels.end(), label) !=
+         supportedLabels.end() &&
+      find(supportedOrigins.begin(), supportedOrigins.end(), origin) !=
+         supportedOrigins.end();
+#ifndef WITH_APT_AUTH
+   res = res && fileComponentSupported(File);
+#endif
 
+   _fileSupport[File->ID] = res ? Supported : Unsupported;
    return res;
 }
 
+bool RPackageStatus::findSupported(RPackage *pkg, pkgCache::VerIterator Ver)
+{
+   // without a candidate it can not be trusted
+   if (Ver.end())
+      return false;
+   pkgCache::VerFileIterator VF = Ver.FileList();
+   if (VF.end() || !fileSupported(VF.File()))
+      return false;
+
+#ifdef WITH_APT_AUTH
+   if (!componentSupported(pkg))
+      return false;
+#endif
+
+   return pkg->isTrusted();
+}
+
+bool RPackageStatus::isSupported(RPackage *pkg) 
+{
+   if (!markUnsupported)
+      return true;
+
+   resetSupport(pkg->_lister);
+
+   pkgDepCache *deps = pkg->_lister->getCache()->deps();
+   pkgCache::VerIterator Ver = (*deps)[*pkg->package()].CandidateVerIter(*deps);
+   uint32_t candidate = Ver.end() ? 0 : Ver->ID + 1;
+   packageSupport &entry = _packageSupport[pkg->id()];
+   if (entry.state == Unknown || entry.candidate != candidate) {
+      entry.candidate = candidate;
+      entry.state = findSupported(pkg, Ver) ? Supported : Unsupported;
+   }
+   return entry.state == Supported;
+}
+
 int RPackageStatus::getStatus(RPackage *pkg)
 {
    int flags = pkg->getFlags();
@@ -33,6 +33,7 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <stdint.h>
 #include <apt-pkg/configuration.h>
 #include <apt-pkg/fileutl.h>
 
@@ -60,6 +61,28 @@ class RPackageStatus {
    vector<string> supportedComponents;
    bool markUnsupported;
 
+   // isSupported() worked out once for each package file of the cache
+   // and once for each package, as long as its candidate stays the same
+   enum { Unknown, Unsupported, Supported };
+   struct packageSupport {
+      uint32_t candidate;       // version id + 1, 0 for none
+      uint8_t state;
+   };
+   vector<uint8_t> _fileSupport;
+   vector<packageSupport> _packageSupport;
+   // the component alone, by package file, or with apt-secure by
+   // RPackageColumns::sectionId()
+   vector<uint8_t> _componentSupport;
+   RPackageLister *_supportLister;
+   unsigned int _supportGeneration;
+
+   void resetSupport(RPackageLister *lister);
+   bool supportedComponent(const string &component);
+   // without apt-secure only
+   bool fileComponentSupported(pkgCache::PkgFileIterator File);
+   bool fileSupported(pkgCache::PkgFileIterator File);
+   bool findSupported(RPackage *pkg, pkgCache::VerIterator Ver);
+
    // this is the short string to load the icons
    const char *PackageStatusShortString[N_STATUS_COUNT];
    // this is the long string for the gui description of the state
@@ -70,7 +93,9 @@ class RPackageStatus {
 
 
  public:
-   RPackageStatus() : markUnsupported(false) {}
+   RPackageStatus()
+      : markUnsupported(false), _supportLister(NULL), _supportGeneration(0)
+   {}
    virtual ~RPackageStatus() {}
 
    // this reads the pixmaps and the colors
@@ -89,6 +114,9 @@ class RPackageStatus {
    }
 
    bool isSupported(RPackage *pkg);
+   // only the supported-components part of it, which the status view
+   // marks
+   bool componentSupported(RPackage *pkg);
 
    // return the time until the package is supported
    bool maintenanceEndTime(RPackage *pkg, struct tm *support_end_tm);
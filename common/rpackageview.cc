@@ -27,6 +27,9 @@
 #include <apt-pkg/configuration.h>
 #include <rpackage.h>
 #include <rpackageview.h>
+#include <rparallelmatch.h>
+#include <rpackagelister.h>
+#include <rsearchindex.h>
 #include <rconfiguration.h>
 
 #include <map>
@@ -40,21 +43,38 @@ using namespace std;
 
 bool RPackageView::setSelected(string name)
 {
-   map<string, vector<RPackage *> >::iterator I = _view.find(name);
+   map<string, RPackageSet>::iterator I = _view.find(name);
    if (I != _view.end()) {
       _hasSelection = true;
       _selectedName = name;
-      _selectedView = (*I).second;
    } else {
       clearSelection();
    }
    return _hasSelection;
 }
 
+const RPackageSet &RPackageView::selectedSet()
+{
+   static const RPackageSet empty;
+
+   if (!_hasSelection)
+      return _showAll ? _allSet : empty;
+
+   map<string, RPackageSet>::iterator I = _view.find(_selectedName);
+   if (I == _view.end())
+      return empty;
+   return (*I).second;
+}
+
+void RPackageView::getPackages(vector<RPackage *> &pkgs)
+{
+   selectedSet().getPackages(_packages, pkgs);
+}
+
 vector<string> RPackageView::getSubViews()
 {
    vector<string> subViews;
-   for (map<string, vector<RPackage *> >::iterator I = _view.begin();
+   for (map<string, RPackageSet>::iterator I = _view.begin();
         I != _view.end(); I++)
       subViews.push_back((*I).first);
    return subViews;
@@ -64,18 +84,61 @@ void RPackageView::clear()
 {
    clearSelection();
    _view.clear();
-}
-
-bool RPackageView::hasPackage(RPackage *pkg)
-{
-   return find(_selectedView.begin(), _selectedView.end(), pkg)  != _selectedView.end();
+   _isBuilt = false;
 }
 
 void RPackageView::clearSelection()
 {
    _hasSelection = false;
    _selectedName.clear();
-   _selectedView.clear();
+   _showAll = false;
+}
+
+void RPackageView::refreshAll()
+{
+   _allSet.clear();
+   _allSet.add(_all);
+}
+
+void RPackageView::selectedPackages(const vector<RPackage *> &changed,
+                                    vector<RPackage *> &visible)
+{
+   RPackageSet changedSet;
+   changedSet.add(changed);
+   changedSet.intersect(selectedSet());
+   changedSet.getPackages(_packages, visible);
+}
+
+bool RPackageView::refreshPackages(const vector<RPackage *> &changed,
+                                   vector<RPackage *> &visible)
+{
+   if(_config->FindB("Debug::Synaptic::View",false))
+      ioprintf(clog, "RPackageView::refreshPackages(): '%s' %i packages\n",
+	       getName().c_str(), (int)changed.size());
+
+   // take the changed packages out of all sub views, addPackage()
+   // puts them back where their new state belongs
+   RPackageSet changedSet;
+   changedSet.add(changed);
+   for (map<string, RPackageSet>::iterator I = _view.begin();
+        I != _view.end(); I++)
+      (*I).second.subtract(changedSet);
+
+   for (unsigned int i = 0; i < changed.size(); i++) {
+      if (_allSet.contains(changed[i]))
+         addPackage(changed[i]);
+   }
+
+   for (map<string, RPackageSet>::iterator I = _view.begin();
+        I != _view.end(); ) {
+      if ((*I).second.empty())
+         _view.erase(I++);
+      else
+         I++;
+   }
+
+   selectedPackages(changed, visible);
+   return true;
 }
 
 void RPackageView::refresh()
@@ -84,6 +147,8 @@ void RPackageView::refresh()
       ioprintf(clog, "RPackageView::refresh(): '%s'\n",
 	       getName().c_str());
 
+   refreshAll();
+
    _view.clear();
    for(unsigned int i=0;i<_all.size();i++) {
       if(_all[i])
@@ -91,45 +156,69 @@ void RPackageView::refresh()
    }
 }
 
+void RPackageView::refreshByColumn(
+   unsigned int (RPackageColumns::*columnId)(RPackage *),
+   string (*subView)(const string &value))
+{
+   if(_config->FindB("Debug::Synaptic::View",false))
+      ioprintf(clog, "RPackageView::refreshByColumn(): '%s'\n",
+	       getName().c_str());
+
+   refreshAll();
+
+   _view.clear();
+   RPackageColumns *columns = NULL;
+   vector<RPackageSet> byId;
+   for(unsigned int i=0;i<_all.size();i++) {
+      if(!_all[i])
+	 continue;
+      columns = _all[i]->_lister->getColumns();
+      unsigned int id = (columns->*columnId)(_all[i]);
+      if(id >= byId.size())
+	 byId.resize(id + 1);
+      byId[id].add(_all[i]);
+   }
+   for(unsigned int id=0;id<byId.size();id++) {
+      if(!byId[id].empty())
+	 _view[subView(columns->getString(id))].unite(byId[id]);
+   }
+}
+
+static string sectionSubView(const string &section)
+{
+   return trans_section(section);
+}
+
 void RPackageViewSections::addPackage(RPackage *package)
 {
    string str = trans_section(package->section());
-   _view[str].push_back(package);
+   _view[str].add(package);
 }
 
-RPackageViewStatus::RPackageViewStatus(vector<RPackage *> &allPkgs)
-   : RPackageView(allPkgs), markUnsupported(false)
+void RPackageViewSections::refresh()
 {
-   if(_config->FindB("Synaptic::mark-unsupported",false)) {
-      markUnsupported = true;
-      string components = _config->Find("Synaptic::supported-components", "main updates/main");
+   refreshByColumn(&RPackageColumns::sectionId, sectionSubView);
+}
 
-      stringstream sstream(components);
-      string s;
-      while(!sstream.eof()) {
-	 sstream >> s;
-	 supportedComponents.push_back(s);
-      }
-   }
+RPackageViewStatus::RPackageViewStatus(vector<RPackage *> &pkgs,
+                                       vector<RPackage *> &allPkgs)
+   : RPackageView(pkgs, allPkgs), markUnsupported(false)
+{
+   // the supported components are the ones of RPackageStatus, which
+   // reads them whenever this is set
+   markUnsupported = _config->FindB("Synaptic::mark-unsupported",false);
 }
 
 void RPackageViewStatus::addPackage(RPackage *pkg)
 {
    string str;
    int flags = pkg->getFlags();
-   string component = pkg->component();
    bool unsupported = false;
 
-   // we mark packages as unsupported if requested
-   if(markUnsupported) {
-      unsupported = true;
-      for(unsigned int i=0;i<supportedComponents.size();i++) {
-	 if(supportedComponents[i] == component) {
-	    unsupported = false;
-	    break;
-	 }
-      }
-   }
+   // we mark packages as unsupported if requested; worked out once per
+   // package file (or section) of the cache
+   if(markUnsupported)
+      unsupported = !pkg->_lister->getPackageStatus()->componentSupported(pkg);
 
    if(flags & RPackage::FInstalled) {
       if( !(flags & RPackage::FNotInstallable) && unsupported)
@@ -142,13 +231,13 @@ void RPackageViewStatus::addPackage(RPackage *pkg)
       else
 	 str = _("Not installed");
    }
-   _view[str].push_back(pkg);
+   _view[str].add(pkg);
 
    if ((flags & RPackage::FInstalled) &&
        (flags & RPackage::FIsGarbage))
    {
       str = _("Installed (auto removable)");
-      _view[str].push_back(pkg);
+      _view[str].add(pkg);
    }
 
    if ((flags & RPackage::FInstalled) &&
@@ -156,7 +245,7 @@ void RPackageViewStatus::addPackage(RPackage *pkg)
        !(flags & RPackage::FImportant))
    {
       str = _("Installed (manual)");
-      _view[str].push_back(pkg);
+      _view[str].add(pkg);
    }
 
    str.clear();
@@ -179,20 +268,20 @@ void RPackageViewStatus::addPackage(RPackage *pkg)
    }
 
    if(!str.empty())
-      _view[str].push_back(pkg);
+      _view[str].add(pkg);
 }
 
 
 //------------------------------------------------------------------
 
-void RPackageViewSearch::addPackage(RPackage *pkg)
+bool RPackageViewSearch::matches(RPackage *pkg, pkgRecords &records)
 {
    string str;
    const char *tmp=NULL;
    bool global_found=true;
 
    if(!pkg || _currentSearchItem.searchStrings.empty())
-      return;
+      return false;
 
    // build the string
    switch(_currentSearchItem.searchType) {
@@ -203,18 +292,26 @@ void RPackageViewSearch::addPackage(RPackage *pkg)
       tmp = pkg->availableVersion();
       break;
    case RPatternPackageFilter::Description:
-      str = pkg->name();
-      str += string(pkg->summary());
-      str += string(pkg->description());
-      break;
+      {
+	 // looked at where it is, without copying it
+	 RSearchIndex::Text text;
+	 RSearchIndex::text(pkg, records, text);
+	 for(unsigned int i=0;i<_currentSearchItem.searchStrings.size();i++) {
+	    if(!RSearchIndex::contains(text, _currentSearchItem.searchStrings[i]))
+	       return false;
+	 }
+	 return true;
+      }
    case RPatternPackageFilter::Maintainer:
-      tmp = pkg->maintainer();
+      str = pkg->maintainer(records);
       break;
    case RPatternPackageFilter::Depends:
       {
-	 vector<DepInformation> d = pkg->enumDeps(true);
-	 for(unsigned int i=0;i<d.size();i++)
-	    str += string(d[i].name);
+	 pkgCache::VerIterator ver = pkg->depsVersion(true);
+	 if(ver.end())
+	    break;
+	 for(pkgCache::DepIterator D = ver.DependsList(); !D.end(); D++)
+	    str += D.TargetPkg().Name();
 	 break;
       }
    case RPatternPackageFilter::Provides:
@@ -231,7 +328,7 @@ void RPackageViewSearch::addPackage(RPackage *pkg)
 
    // find the search pattern in the string "str"
    for(unsigned int i=0;i<_currentSearchItem.searchStrings.size();i++) {
-      string searchString = _currentSearchItem.searchStrings[i];
+      const string &searchString = _currentSearchItem.searchStrings[i];
 
       if(!str.empty() && strcasestr(str.c_str(), searchString.c_str())) {
 	 global_found &= true;
@@ -239,15 +336,15 @@ void RPackageViewSearch::addPackage(RPackage *pkg)
 	 global_found &= false;
       }
    }
-   if(global_found) {
-      _view[_currentSearchItem.searchName].push_back(pkg);
+   return global_found;
+}
+
+void RPackageViewSearch::addPackage(RPackage *pkg)
+{
+   if(pkg && matches(pkg, *pkg->records())) {
+      _view[_currentSearchItem.searchName].add(pkg);
       found++;
    }
-
-   // FIXME: we push a _lot_ of empty pkgs here :(
-   // push a empty package in the view to make sure that the view is actually
-   // displayed
-   //_view[searchString].push_back(NULL);
 }
 
 bool RPackageViewSearch::setSelected(string name)
@@ -274,6 +371,13 @@ bool RPackageViewSearch::setSelected(string name)
    return RPackageView::setSelected(name);
 }
 
+bool RPackageViewSearch::refreshPackages(const vector<RPackage *> &changed,
+                                         vector<RPackage *> &visible)
+{
+   selectedPackages(changed, visible);
+   return true;
+}
+
 vector<string> RPackageViewSearch::getSubViews()
 {
    vector<string> subviews;
@@ -284,6 +388,14 @@ vector<string> RPackageViewSearch::getSubViews()
    return subviews;
 }
 
+struct RPackageViewSearch::searchMatcher : public RPackageMatcher {
+   RPackageViewSearch *_search;
+   searchMatcher(RPackageViewSearch *search) : _search(search) {}
+   bool match(RPackage *pkg, pkgRecords &records) {
+      return _search->matches(pkg, records);
+   }
+};
+
 int RPackageViewSearch::setSearch(string aSearchName,
 				  int type,
 				  string searchString,
@@ -308,21 +420,62 @@ int RPackageViewSearch::setSearch(string aSearchName,
    // overwrite existing ones
    searchHistory[aSearchName] =  _currentSearchItem;
 
-   // setup search progress (0 done, _all.size() in total, 1 subtask)
-   searchProgress.OverallProgress(0, _all.size(), 1, _("Searching"));
+   // the view may not have been looked at since the cache was opened
+   refreshAll();
+   if (_all.empty())
+      return found;
+   RPackageLister *lister = _all[0]->_lister;
+
+   // the same search again (e.g. from the history) only looks at the
+   // packages it did not see before; everything but the name comes
+   // from the candidate, which "Force Version" changes
+   RSearchCache::Entry *entry = lister->findSearch(searchString, type);
+   if (entry == NULL) {
+      bool dependsOnCandidate = type != RPatternPackageFilter::Name;
+      entry = lister->addSearch(searchString, type, dependsOnCandidate);
+   }
+
+   // the name and the description are in the search index, only the
+   // packages that have all the trigrams of the words are looked at
+   RPackageSet set;
+   bool indexed = false;
+   if (type == RPatternPackageFilter::Name ||
+       type == RPatternPackageFilter::Description) {
+      RSearchIndex *index = lister->getSearchIndex(&searchProgress);
+      if (index != NULL &&
+          index->candidates(_currentSearchItem.searchStrings, set)) {
+         set.intersect(_allSet);
+         indexed = true;
+      }
+   }
+   if (!indexed)
+      set = _allSet;
+
+   RPackageSet &result = _view[_currentSearchItem.searchName];
+   result = set;
+   result.intersect(entry->matched);
+   set.subtract(entry->checked);
+   vector<RPackage *> pkgs;
+   set.getPackages(_packages, pkgs);
+
+   // setup search progress (0 done, pkgs.size() in total, 1 subtask)
+   searchProgress.OverallProgress(0, pkgs.size(), 1, _("Searching"));
    // reapply search when a new search strng is given
-   for(unsigned int i=0;i<_all.size();i++)
-     if(_all[i]) {
-       searchProgress.Progress(i);
-       addPackage(_all[i]);
-     }
+   searchMatcher matcher(this);
+   vector<RPackage *> matches;
+   RMatchPackages(pkgs, matcher, matches, &searchProgress);
+   entry->checked.add(pkgs);
+   entry->matched.add(matches);
+   result.add(matches);
+   found = result.count();
    searchProgress.Done();
    return found;
 }
 //------------------------------------------------------------------
 
-RPackageViewFilter::RPackageViewFilter(vector<RPackage *> &allPkgs)
-   : RPackageView(allPkgs)
+RPackageViewFilter::RPackageViewFilter(vector<RPackage *> &pkgs,
+                                       vector<RPackage *> &allPkgs)
+   : RPackageView(pkgs, allPkgs)
 {
    // restore the filters
    restoreFilters();
@@ -333,11 +486,12 @@ RPackageViewFilter::RPackageViewFilter(vector<RPackage *> &allPkgs)
 void RPackageViewFilter::refreshFilters()
 {
    _view.clear();
+   _built.clear();
 
    // create a empty sub-views for each filter
    for (vector<RFilter *>::iterator I = _filterL.begin();
 	I != _filterL.end(); I++) {
-      _view[(*I)->getName()].push_back(NULL);
+      _view[(*I)->getName()];
    }
 }
 
@@ -353,30 +507,61 @@ int RPackageViewFilter::getFilterIndex(RFilter *filter)
 }
 
 
-RPackageViewFilter::iterator RPackageViewFilter::begin()
+void RPackageViewFilter::getPackages(vector<RPackage *> &pkgs)
 {
-//    cout << "RPackageViewFilter::begin() " << _selectedName <<  endl;
+//    cout << "RPackageViewFilter::getPackages() " << _selectedName <<  endl;
 
    string name = _selectedName;
    RFilter *filter = findFilter(name);
 
    if(filter != NULL) {
-      _view[name].clear();
+      vector<RPackage *> matches;
+      filter->apply(_all, matches);
 
-      for(unsigned int i=0;i<_all.size();i++) {
-	 if(_all[i] && filter->apply(_all[i]))
-	    _view[name].push_back(_all[i]);
-      }
-      _selectedView = _view[name];
+      RPackageSet &set = _view[name];
+      set.clear();
+      set.add(matches);
+      _built.insert(name);
    }
 
-   return _selectedView.begin();
+   RPackageView::getPackages(pkgs);
+}
+
+bool RPackageViewFilter::refreshPackages(const vector<RPackage *> &changed,
+                                         vector<RPackage *> &visible)
+{
+   RFilter *filter = findFilter(_selectedName);
+   if (filter == NULL) {
+      selectedPackages(changed, visible);
+      return true;
+   }
+
+   // the sub view was not built by getPackages() yet
+   if (_built.find(_selectedName) == _built.end())
+      return false;
+
+   vector<RPackage *> candidates;
+   for (unsigned int i = 0; i < changed.size(); i++) {
+      if (_allSet.contains(changed[i]))
+         candidates.push_back(changed[i]);
+   }
+   vector<RPackage *> matches;
+   filter->apply(candidates, matches);
+
+   RPackageSet &set = _view[_selectedName];
+   for (unsigned int i = 0; i < changed.size(); i++)
+      set.remove(changed[i]);
+   set.add(matches);
+
+   selectedPackages(changed, visible);
+   return true;
 }
 
 void RPackageViewFilter::refresh()
 {
    //cout << "RPackageViewFilter::refresh() " << endl;
 
+   refreshAll();
    refreshFilters();
 }
 
@@ -590,7 +775,7 @@ void RPackageViewOrigin::addPackage(RPackage *package)
          if (package->getFlags() & RPackage::FNotInstallable)
          {
             origin_url = _("Local");
-            _view[origin_url].push_back(package);
+            _view[origin_url].add(package);
          }
          continue;
       }
@@ -602,7 +787,7 @@ void RPackageViewOrigin::addPackage(RPackage *package)
          string suite = *it2;
          // PPAs are special too
          if(origin_str.find("LP-PPA-") != string::npos) {
-            _view[origin_str+"/"+suite].push_back(package);
+            _view[origin_str+"/"+suite].add(package);
             continue;
          }
 
@@ -614,7 +799,7 @@ void RPackageViewOrigin::addPackage(RPackage *package)
 
          // normal package
          subview = suite+"/"+component+" ("+origin_url+")";
-         _view[subview].push_back(package);
+         _view[subview].add(package);
       }
 
       // see if we have versions that are higher than the candidate
@@ -639,21 +824,31 @@ void RPackageViewOrigin::addPackage(RPackage *package)
          string suite = VF.File().Archive();
          string origin_url = VF.File().Site();
          string subview = prefix + suite + "(" + origin_url + ")";
-         _view[subview].push_back(package);
+         _view[subview].add(package);
       }
    }
 }
 
 
+static string archSubView(const string &arch)
+{
+   return "arch: " + arch;
+}
+
 void RPackageViewArchitecture::addPackage(RPackage *package)
 {
-   string arch = "arch: " + package->arch();
+   string arch = archSubView(package->arch());
 
    // FIXME: add pseudo arch for packages only in one group arch
    //        but not the other
 
 
-   _view[arch].push_back(package);
+   _view[arch].add(package);
+}
+
+void RPackageViewArchitecture::refresh()
+{
+   refreshByColumn(&RPackageColumns::archId, archSubView);
 }
 
 
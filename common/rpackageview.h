@@ -34,7 +34,9 @@
 #endif
 
 #include "rpackage.h"
+#include "rpackageset.h"
 #include "rpackagefilter.h"
+#include "rpackagecolumns.h"
 
 #include "i18n.h"
 
@@ -54,30 +56,57 @@ enum {PACKAGE_VIEW_SECTION,
 class RPackageView {
  protected:
 
-   map<string, vector<RPackage *> > _view;
+   map<string, RPackageSet> _view;
 
    bool _hasSelection;
    string _selectedName;
 
-   // packages in selected
-   vector<RPackage *> _selectedView;
+   // without a selection show _all instead of nothing
+   bool _showAll;
+
+   // the cache and package state generations of the lister the sub
+   // views were built for, see RPackageLister::updateView()
+   bool _isBuilt;
+   unsigned int _cacheGeneration;
+   unsigned int _stateGeneration;
+
+   // all packages of the cache, RPackageSet indexes refer to this
+   vector<RPackage *> &_packages;
 
    // all packages in current global filter
    vector<RPackage *> &_all;
+   RPackageSet _allSet;
+   void refreshAll();
+
+   // packages in selected
+   const RPackageSet &selectedSet();
+
+   // the packages of "changed" that are also in the selected sub view
+   void selectedPackages(const vector<RPackage *> &changed,
+                         vector<RPackage *> &visible);
+
+   // refresh() for views where the sub view of a package only depends
+   // on one interned column string: the packages are grouped by the id
+   // of that and the sub view name is worked out once per id
+   void refreshByColumn(unsigned int (RPackageColumns::*columnId)(RPackage *),
+                        string (*subView)(const string &value));
 
  public:
-   RPackageView(vector<RPackage *> &allPackages): _all(allPackages) {}
+   RPackageView(vector<RPackage *> &packages, vector<RPackage *> &allPackages)
+      : _hasSelection(false), _showAll(false), _isBuilt(false),
+        _cacheGeneration(0), _stateGeneration(0), _packages(packages),
+        _all(allPackages) {}
    virtual ~RPackageView() {}
 
    bool hasSelection() { return _hasSelection; }
    string getSelected() { return _selectedName; }
-   bool hasPackage(RPackage *pkg);
+   bool hasPackage(RPackage *pkg) { return selectedSet().contains(pkg); }
    virtual bool setSelected(string name);
 
    void showAll() {
-      _selectedView = _all;
       _hasSelection = false;
       _selectedName.clear();
+      _showAll = true;
    }
 
    virtual vector<string> getSubViews();
@@ -85,33 +114,56 @@ class RPackageView {
    virtual string getName() = 0;
    virtual void addPackage(RPackage *package) = 0;
 
-   typedef vector<RPackage *>::iterator iterator;
-
-   virtual iterator begin() { return _selectedView.begin(); }
-   virtual iterator end() { return _selectedView.end(); }
+   // appends the packages of the selected sub view in name order
+   virtual void getPackages(vector<RPackage *> &pkgs);
 
    virtual void clear();
    virtual void clearSelection();
 
    virtual void refresh();
+
+   // views whose sub views only depend on what is in the cache stay
+   // current when packages are marked
+   virtual bool dependsOnState() { return true; }
+   bool isCurrent(unsigned int cacheGeneration,
+                  unsigned int stateGeneration) {
+      return _isBuilt && _cacheGeneration == cacheGeneration &&
+             (!dependsOnState() || _stateGeneration == stateGeneration);
+   }
+   void setCurrent(unsigned int cacheGeneration,
+                   unsigned int stateGeneration) {
+      _isBuilt = true;
+      _cacheGeneration = cacheGeneration;
+      _stateGeneration = stateGeneration;
+   }
+
+   // bring the sub views up to date for the packages in "changed" only
+   // and return the ones that are shown in the selected sub view in
+   // "visible"; returns false if a full refresh() is needed instead
+   virtual bool refreshPackages(const vector<RPackage *> &changed,
+                                vector<RPackage *> &visible);
 };
 
 
 
 class RPackageViewSections : public RPackageView {
  public:
-   RPackageViewSections(vector<RPackage *> &allPkgs) : RPackageView(allPkgs) {}
+   RPackageViewSections(vector<RPackage *> &pkgs, vector<RPackage *> &allPkgs)
+      : RPackageView(pkgs, allPkgs) {}
 
    string getName() {
       return _("Sections");
    };
 
    void addPackage(RPackage *package);
+   void refresh();
+   bool dependsOnState() { return false; }
 };
 
 class RPackageViewAlphabetic : public RPackageView {
  public:
-   RPackageViewAlphabetic(vector<RPackage *> &allPkgs) : RPackageView(allPkgs) {}
+   RPackageViewAlphabetic(vector<RPackage *> &pkgs, vector<RPackage *> &allPkgs)
+      : RPackageView(pkgs, allPkgs) {}
    string getName() {
       return _("Alphabetic");
    }
@@ -119,23 +171,27 @@ class RPackageViewAlphabetic : public RPackageView {
    void addPackage(RPackage *package) {
       char letter[2] = { ' ', '\0' };
       letter[0] = toupper(package->name()[0]);
-      _view[letter].push_back(package);
+      _view[letter].add(package);
    }
 };
 
 class RPackageViewArchitecture : public RPackageView {
  public:
-   RPackageViewArchitecture(vector<RPackage *> &allPkgs) : RPackageView(allPkgs) {}
+   RPackageViewArchitecture(vector<RPackage *> &pkgs, vector<RPackage *> &allPkgs)
+      : RPackageView(pkgs, allPkgs) {}
    string getName() {
       return _("Architecture");
    }
 
    void addPackage(RPackage *package);
+   void refresh();
+   bool dependsOnState() { return false; }
 };
 
 class RPackageViewOrigin : public RPackageView {
  public:
-   RPackageViewOrigin(vector<RPackage *> &allPkgs) : RPackageView(allPkgs) {}
+   RPackageViewOrigin(vector<RPackage *> &pkgs, vector<RPackage *> &allPkgs)
+      : RPackageView(pkgs, allPkgs) {}
    string getName() {
       return _("Origin");
    }
@@ -147,10 +203,9 @@ class RPackageViewStatus:public RPackageView {
  protected:
    // mark the software as unsupported in status view
    bool markUnsupported;
-   vector<string> supportedComponents;
 
  public:
-   RPackageViewStatus(vector<RPackage *> &allPkgs);
+   RPackageViewStatus(vector<RPackage *> &pkgs, vector<RPackage *> &allPkgs);
 
    string getName() {
       return _("Status");
@@ -172,9 +227,13 @@ class RPackageViewSearch : public RPackageView {
 
    bool xapianSearch();
 
+   // may run on several threads at once, see setSearch()
+   bool matches(RPackage *pkg, pkgRecords &records);
+   struct searchMatcher;
+
  public:
- RPackageViewSearch(vector<RPackage *> &allPkgs)
-    : RPackageView(allPkgs), found(0) {}
+ RPackageViewSearch(vector<RPackage *> &pkgs, vector<RPackage *> &allPkgs)
+    : RPackageView(pkgs, allPkgs), found(0) {}
 
    int setSearch(string searchName, int type, string searchString,
 		 OpProgress &searchProgress);
@@ -189,8 +248,12 @@ class RPackageViewSearch : public RPackageView {
 
    void addPackage(RPackage *package);
 
-   // no-op
-   virtual void refresh() {}
+   // the search results are only redone by setSearch()
+   virtual void refresh() { refreshAll(); }
+
+   // the search results do not depend on the package state
+   virtual bool refreshPackages(const vector<RPackage *> &changed,
+                                vector<RPackage *> &visible);
 };
 
 
@@ -199,6 +262,9 @@ class RPackageViewFilter : public RPackageView {
    vector<RFilter *> _filterL;
    set<string> _sectionList;   // list of all available package sections
 
+   // the filters whose sub view getPackages() built already
+   set<string> _built;
+
  public:
    void storeFilters();
    void restoreFilters();
@@ -226,14 +292,18 @@ class RPackageViewFilter : public RPackageView {
    vector<string> getFilterNames();
    const set<string> &getSections();
 
-   RPackageViewFilter(vector<RPackage *> &allPkgs);
+   RPackageViewFilter(vector<RPackage *> &pkgs, vector<RPackage *> &allPkgs);
 
    // build packages list on "demand"
-   virtual iterator begin();
+   virtual void getPackages(vector<RPackage *> &pkgs);
 
    // we never need to clear because we build the view "on-demand"
    virtual void clear() { clearSelection(); }
 
+   // re-apply the selected filter to the changed packages only
+   virtual bool refreshPackages(const vector<RPackage *> &changed,
+                                vector<RPackage *> &visible);
+
    string getName() {
       return _("Custom");
    }
@@ -0,0 +1,142 @@
+/* rparallelmatch.cc - match packages on several threads
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <apt-pkg/configuration.h>
+
+#include "rpackagelister.h"
+#include "rparallelmatch.h"
+
+// packages handed out to a thread at a time, small enough to spread
+// the slow ones (long descriptions) and to report progress often
+static const unsigned int ChunkSize = 128;
+static const int MaxThreads = 64;
+
+struct matchJob {
+   const vector<RPackage *> *pkgs;
+   RPackageMatcher *matcher;
+   pkgCache *cache;
+   // one entry per package, written by whichever thread got its chunk
+   vector<char> matched;
+   // next package to hand out and number of packages done
+   volatile unsigned int next;
+   volatile unsigned int done;
+};
+
+// runs chunks until none are left, returns false if there was nothing
+// to do anymore when called
+static bool matchChunk(matchJob *job, pkgRecords &records)
+{
+   unsigned int size = job->pkgs->size();
+   unsigned int start = __sync_fetch_and_add(&job->next, ChunkSize);
+   if (start >= size)
+      return false;
+
+   unsigned int end = start + ChunkSize;
+   if (end > size)
+      end = size;
+   for (unsigned int i = start; i < end; i++) {
+      RPackage *pkg = (*job->pkgs)[i];
+      job->matched[i] = pkg != NULL && job->matcher->match(pkg, records);
+   }
+   __sync_fetch_and_add(&job->done, end - start);
+   return true;
+}
+
+static void *matchThread(void *data)
+{
+   matchJob *job = (matchJob *)data;
+
+   // pkgRecords::Lookup() keeps the parser state, each thread needs
+   // its own
+   pkgRecords records(*job->cache);
+   while (matchChunk(job, records));
+   return NULL;
+}
+
+static int matchThreadCount(unsigned int size)
+{
+   int threads = _config->FindI("Synaptic::SearchThreads", 0);
+   if (threads <= 0)
+      threads = sysconf(_SC_NPROCESSORS_ONLN);
+   if (threads > MaxThreads)
+      threads = MaxThreads;
+
+   // no point in threads without a chunk to work on
+   int chunks = (size + ChunkSize - 1) / ChunkSize;
+   if (threads > chunks)
+      threads = chunks;
+   if (threads < 1)
+      threads = 1;
+   return threads;
+}
+
+void RMatchPackages(const vector<RPackage *> &pkgs, RPackageMatcher &matcher,
+                    vector<RPackage *> &result, OpProgress *progress)
+{
+   if (pkgs.empty())
+      return;
+
+   RPackage *first = NULL;
+   for (unsigned int i = 0; i < pkgs.size() && first == NULL; i++)
+      first = pkgs[i];
+   if (first == NULL)
+      return;
+
+   matchJob job;
+   job.pkgs = &pkgs;
+   job.matcher = &matcher;
+   job.cache = &first->_lister->getCache()->deps()->GetCache();
+   job.matched.resize(pkgs.size(), 0);
+   job.next = 0;
+   job.done = 0;
+
+   int threads = matchThreadCount(pkgs.size());
+   if (_config->FindB("Debug::Synaptic::View", false))
+      clog << "RMatchPackages: " << pkgs.size() << " packages, "
+           << threads << " threads" << endl;
+
+   // this thread does its share too, with the shared records
+   vector<pthread_t> workers;
+   for (int i = 1; i < threads; i++) {
+      pthread_t thread;
+      if (pthread_create(&thread, NULL, matchThread, &job) != 0)
+         break;
+      workers.push_back(thread);
+   }
+
+   pkgRecords &records = *first->records();
+   while (matchChunk(&job, records)) {
+      if (progress != NULL)
+         progress->Progress(job.done);
+   }
+
+   for (unsigned int i = 0; i < workers.size(); i++)
+      pthread_join(workers[i], NULL);
+   if (progress != NULL)
+      progress->Progress(pkgs.size());
+
+   for (unsigned int i = 0; i < pkgs.size(); i++) {
+      if (job.matched[i])
+         result.push_back(pkgs[i]);
+   }
+}
+
+// vim:ts=3:sw=3:et
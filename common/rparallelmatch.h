@@ -0,0 +1,49 @@
+/* rparallelmatch.h - match packages on several threads
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RPARALLELMATCH_H
+#define RPARALLELMATCH_H
+
+#include <vector>
+
+#include <apt-pkg/pkgrecords.h>
+#include <apt-pkg/progress.h>
+
+#include "rpackage.h"
+
+using namespace std;
+
+// A test run on many packages at once. match() is called from several
+// threads, it must only read the package and go to the records through
+// the given parser, which belongs to the calling thread.
+class RPackageMatcher {
+ public:
+   virtual bool match(RPackage *pkg, pkgRecords &records) = 0;
+   virtual ~RPackageMatcher() {}
+};
+
+// Appends the packages of pkgs that match to result, in the order of
+// pkgs. The work is split over Synaptic::SearchThreads threads (one
+// per processor if not set). progress gets the number of packages
+// done so far.
+void RMatchPackages(const vector<RPackage *> &pkgs, RPackageMatcher &matcher,
+                    vector<RPackage *> &result, OpProgress *progress = NULL);
+
+#endif
+
+// vim:ts=3:sw=3:et
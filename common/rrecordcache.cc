@@ -0,0 +1,207 @@
+/* rrecordcache.cc - the package records read last
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include <apt-pkg/configuration.h>
+
+#include "rrecordcache.h"
+
+RRecordCache::RRecordCache()
+   : _records(NULL)
+{
+   int size = _config->FindI("Synaptic::RecordCacheSize", 64);
+   _size = size < (int)MinSize ? MinSize : size;
+}
+
+RRecordCache::~RRecordCache()
+{
+   clear();
+}
+
+void RRecordCache::drop(Record &rec)
+{
+   delete rec.section;
+   rec.section = NULL;
+}
+
+void RRecordCache::clear()
+{
+   for (list<Record>::iterator I = _entries.begin(); I != _entries.end(); I++)
+      drop(*I);
+   _entries.clear();
+}
+
+void RRecordCache::setRecords(pkgRecords *records)
+{
+   clear();
+   _records = records;
+}
+
+RRecordCache::Record *RRecordCache::find(unsigned long file,
+                                         unsigned long offset)
+{
+   for (list<Record>::iterator I = _entries.begin(); I != _entries.end(); I++) {
+      if (I->file == file && I->offset == offset) {
+         // entries do not move in memory when the list is reordered
+         _entries.splice(_entries.begin(), _entries, I);
+         return &_entries.front();
+      }
+   }
+   return NULL;
+}
+
+RRecordCache::Record *RRecordCache::add(pkgRecords::Parser &parser,
+                                        unsigned long file,
+                                        unsigned long offset)
+{
+   while (_entries.size() >= _size) {
+      drop(_entries.back());
+      _entries.pop_back();
+   }
+
+   _entries.push_front(Record());
+   Record &rec = _entries.front();
+   rec.file = file;
+   rec.offset = offset;
+   rec.size = 0;
+   rec.parsed = 0;
+   rec.section = NULL;
+   rec.formatted = false;
+
+   const char *start, *stop;
+   parser.GetRec(start, stop);
+   if (start != NULL && stop > start) {
+      rec.size = stop - start;
+      rec.text.reserve(rec.size + 2);
+      rec.text.assign(start, rec.size);
+      rec.text += "\n\n";
+   }
+
+   return &rec;
+}
+
+RRecordCache::Record *RRecordCache::lookup(pkgCache::VerFileIterator vf)
+{
+   if (_records == NULL || vf.end())
+      return NULL;
+
+   Record *rec = find(vf->File, vf->Offset);
+   if (rec == NULL)
+      rec = add(_records->Lookup(vf), vf->File, vf->Offset);
+   return rec;
+}
+
+RRecordCache::Record *RRecordCache::lookup(pkgCache::DescFileIterator df)
+{
+   if (_records == NULL || df.end())
+      return NULL;
+
+   Record *rec = find(df->File, df->Offset);
+   if (rec == NULL)
+      rec = add(_records->Lookup(df), df->File, df->Offset);
+   return rec;
+}
+
+pkgTagSection *RRecordCache::section(Record *rec)
+{
+   if (rec->section == NULL && rec->size > 0) {
+      rec->section = new pkgTagSection;
+      if (!rec->section->Scan(rec->text.c_str(), rec->text.size())) {
+         delete rec->section;
+         rec->section = NULL;
+      }
+   }
+   return rec->section;
+}
+
+const char *RRecordCache::field(Record *rec, unsigned int bit,
+                                string &value, const char *tag)
+{
+   if (!(rec->parsed & bit)) {
+      pkgTagSection *sec = section(rec);
+      if (sec != NULL)
+         value = sec->FindS(tag);
+      rec->parsed |= bit;
+   }
+   return value.c_str();
+}
+
+string RRecordCache::longDesc(Record *rec, const char *lang)
+{
+   pkgTagSection *sec = section(rec);
+   if (sec == NULL)
+      return string();
+
+   string desc;
+   if (lang != NULL && *lang != 0)
+      desc = sec->FindS((string("Description-") + lang).c_str());
+   if (desc.empty())
+      desc = sec->FindS("Description");
+   return desc;
+}
+
+const char *RRecordCache::shortDesc(Record *rec, const char *lang)
+{
+   if (!(rec->parsed & ShortDesc)) {
+      rec->shortDesc = longDesc(rec, lang);
+      string::size_type eol = rec->shortDesc.find('\n');
+      if (eol != string::npos)
+         rec->shortDesc.erase(eol);
+      rec->parsed |= ShortDesc;
+   }
+   return rec->shortDesc.c_str();
+}
+
+const char *RRecordCache::maintainer(Record *rec)
+{
+   return field(rec, Maintainer, rec->maintainer, "Maintainer");
+}
+
+const char *RRecordCache::homepage(Record *rec)
+{
+   return field(rec, Homepage, rec->homepage, "Homepage");
+}
+
+const char *RRecordCache::sourcePkg(Record *rec)
+{
+   if (!(rec->parsed & SourcePkg)) {
+      field(rec, SourcePkg, rec->sourcePkg, "Source");
+      string::size_type pos = rec->sourcePkg.find(' ');
+      if (pos != string::npos)
+         rec->sourcePkg.erase(pos);
+   }
+   return rec->sourcePkg.c_str();
+}
+
+string RRecordCache::stanza(Record *rec)
+{
+   if (rec == NULL)
+      return string();
+   return string(rec->text, 0, rec->size);
+}
+
+string RRecordCache::findTag(Record *rec, const char *tag)
+{
+   if (rec == NULL)
+      return string();
+   pkgTagSection *sec = section(rec);
+   if (sec == NULL)
+      return string();
+   return sec->FindS(tag);
+}
+
+// vim:ts=3:sw=3:et
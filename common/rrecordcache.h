@@ -0,0 +1,126 @@
+/* rrecordcache.h - the package records read last
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RRECORDCACHE_H
+#define RRECORDCACHE_H
+
+#include <list>
+#include <string>
+
+#include <apt-pkg/pkgcache.h>
+#include <apt-pkg/pkgrecords.h>
+#include <apt-pkg/tagfile.h>
+
+using namespace std;
+
+// The stanzas of the last few package records that were looked up,
+// least recently used ones are dropped first. A record is found by
+// the package file and the offset of its stanza in there, so the
+// version and the untranslated description of a package share one.
+// pkgRecords::Lookup() seeks and parses the stanza every time, the
+// details of a package read several fields of the same one in a row.
+// Only the stanza is copied on a lookup, a field is taken out of it
+// the first time it is asked for.
+//
+// Only for the main thread, the records are not locked.
+class RRecordCache {
+ public:
+   struct Record {
+      unsigned long file;
+      unsigned long offset;
+
+      // the whole stanza as in the package file, the first size
+      // characters, followed by the empty line pkgTagSection wants
+      string text;
+      unsigned long size;
+
+      // the fields read so far, see fieldBits
+      unsigned int parsed;
+      string shortDesc;
+      string maintainer;
+      string homepage;
+      string sourcePkg;
+
+      // the long description formatted for showing, on first use
+      string description;
+      bool formatted;
+
+      // the positions of its fields, found on the first field asked for
+      pkgTagSection *section;
+   };
+
+ protected:
+   enum fieldBits {
+      ShortDesc = 1 << 0,
+      Maintainer = 1 << 1,
+      Homepage = 1 << 2,
+      SourcePkg = 1 << 3
+   };
+
+   // the version and the description record of two packages, so that
+   // the strings of RPackage::summary(), srcPackage() and the like of
+   // two packages can be used together, as in one expression
+   static const unsigned int MinSize = 4;
+
+   pkgRecords *_records;
+
+   // most recently used first
+   list<Record> _entries;
+   unsigned int _size;
+
+   Record *find(unsigned long file, unsigned long offset);
+   Record *add(pkgRecords::Parser &parser, unsigned long file,
+               unsigned long offset);
+   void drop(Record &rec);
+   pkgTagSection *section(Record *rec);
+   const char *field(Record *rec, unsigned int bit, string &value,
+                     const char *tag);
+
+ public:
+   // the record stays valid for at least the next MinSize - 1 lookups
+   // of other records
+   Record *lookup(pkgCache::VerFileIterator vf);
+   Record *lookup(pkgCache::DescFileIterator df);
+
+   // the fields pkgRecords::Parser has accessors for; the strings stay
+   // valid as long as the record. lang is the one of the description,
+   // "Description-<lang>" in the translations
+   const char *shortDesc(Record *rec, const char *lang);
+   string longDesc(Record *rec, const char *lang);
+   const char *maintainer(Record *rec);
+   const char *homepage(Record *rec);
+   // without the version that may follow it
+   const char *sourcePkg(Record *rec);
+
+   // the stanza as in the package file
+   string stanza(Record *rec);
+   // a field of the record that has no accessor of its own
+   string findTag(Record *rec, const char *tag);
+
+   // the records are the ones of the cache that is open, they go away
+   // with it
+   void setRecords(pkgRecords *records);
+   void clear();
+
+   RRecordCache();
+   ~RRecordCache();
+};
+
+#endif
+
+// vim:ts=3:sw=3:et
@@ -0,0 +1,77 @@
+/* rsearchcache.cc - results of recent searches
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include <apt-pkg/configuration.h>
+
+#include "rsearchcache.h"
+
+RSearchCache::RSearchCache()
+{
+   _size = _config->FindI("Synaptic::SearchCacheSize", 20);
+   // a search is refined from the one before, both have to fit
+   if (_size < 2)
+      _size = 2;
+}
+
+RSearchCache::Entry *RSearchCache::find(const string &query, int type,
+                                        unsigned int cacheGeneration,
+                                        unsigned int candidateGeneration)
+{
+   for (list<Entry>::iterator I = _entries.begin(); I != _entries.end(); I++) {
+      if (I->type != type || I->query != query)
+         continue;
+
+      if (I->cacheGeneration != cacheGeneration ||
+          (I->dependsOnCandidate &&
+           I->candidateGeneration != candidateGeneration)) {
+         _entries.erase(I);
+         return NULL;
+      }
+
+      // entries do not move in memory when the list is reordered
+      _entries.splice(_entries.begin(), _entries, I);
+      return &_entries.front();
+   }
+   return NULL;
+}
+
+RSearchCache::Entry *RSearchCache::add(const string &query, int type,
+                                       unsigned int cacheGeneration,
+                                       unsigned int candidateGeneration,
+                                       bool dependsOnCandidate)
+{
+   for (list<Entry>::iterator I = _entries.begin(); I != _entries.end(); I++) {
+      if (I->type == type && I->query == query) {
+         _entries.erase(I);
+         break;
+      }
+   }
+   while (_entries.size() >= _size)
+      _entries.pop_back();
+
+   _entries.push_front(Entry());
+   Entry &entry = _entries.front();
+   entry.query = query;
+   entry.type = type;
+   entry.cacheGeneration = cacheGeneration;
+   entry.candidateGeneration = candidateGeneration;
+   entry.dependsOnCandidate = dependsOnCandidate;
+   return &entry;
+}
+
+// vim:ts=3:sw=3:et
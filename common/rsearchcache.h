@@ -0,0 +1,83 @@
+/* rsearchcache.h - results of recent searches
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RSEARCHCACHE_H
+#define RSEARCHCACHE_H
+
+#include <list>
+#include <vector>
+#include <string>
+
+#include "rpackageset.h"
+
+using namespace std;
+
+// The results of the last few searches, least recently used ones are
+// dropped first. An entry is only good for the cache generation it was
+// made in, and if it reads the candidate (its version or its record)
+// also only for the candidate generation. Marking packages changes
+// neither.
+class RSearchCache {
+ public:
+   // search types besides the RPatternPackageFilter::DepType ones
+   enum {
+      QuickSearch = -1,
+      XapianSearch = -2
+   };
+
+   struct Entry {
+      string query;
+      int type;
+      unsigned int cacheGeneration;
+      unsigned int candidateGeneration;
+      bool dependsOnCandidate;
+
+      // the packages that were looked at and those of them that matched,
+      // a view that shows other packages only needs to look at those
+      RPackageSet checked;
+      RPackageSet matched;
+
+      // ranked results as package indexes with their relevance, for the
+      // searches that have a ranking
+      vector<unsigned int> order;
+      vector<int> percent;
+   };
+
+ protected:
+   // most recently used first
+   list<Entry> _entries;
+   unsigned int _size;
+
+ public:
+   // NULL if there is no usable entry, the one found becomes the most
+   // recently used
+   Entry *find(const string &query, int type, unsigned int cacheGeneration,
+               unsigned int candidateGeneration);
+
+   // a new empty entry, replaces one for the same search
+   Entry *add(const string &query, int type, unsigned int cacheGeneration,
+              unsigned int candidateGeneration, bool dependsOnCandidate);
+
+   void clear() { _entries.clear(); }
+
+   RSearchCache();
+};
+
+#endif
+
+// vim:ts=3:sw=3:et
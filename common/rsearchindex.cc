@@ -0,0 +1,612 @@
+/* rsearchindex.cc - trigram index of the package texts
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/aptconfiguration.h>
+#include <apt-pkg/fileutl.h>
+#include <apt-pkg/error.h>
+
+#include "rsearchindex.h"
+#include "rpackagelister.h"
+#include "i18n.h"
+
+// what is at the start of a saved index, followed by the offsets,
+// counts, signatures and name offsets, then the names and the postings
+struct indexHeader {
+   char magic[8];
+   uint32_t version;
+   uint32_t buckets;
+   uint64_t cacheMtime;
+   uint64_t cacheSize;
+   uint32_t languages;
+   uint32_t packageCount;
+   uint32_t namesSize;
+   uint32_t postingsSize;
+};
+
+static const char IndexMagic[8] = "SYNIDX\n";
+static const uint32_t IndexVersion = 2;
+
+static uint32_t fnvHash(uint32_t hash, const char *str)
+{
+   for (; str != NULL && *str != 0; str++)
+      hash = (hash ^ (unsigned char)*str) * 16777619U;
+   return hash;
+}
+
+// same folding as strcasestr() in the C locale
+static inline unsigned char foldChar(unsigned char c)
+{
+   return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+unsigned int RSearchIndex::bucket(const unsigned char *p)
+{
+   unsigned int key = (foldChar(p[0]) << 16) | (foldChar(p[1]) << 8) |
+                      foldChar(p[2]);
+   return (key * 2654435761U) >> (32 - BucketBits);
+}
+
+void RSearchIndex::addBuckets(const RTextRef &text,
+                              vector<unsigned int> &result)
+{
+   const unsigned char *p = (const unsigned char *)text.start;
+   for (unsigned long i = 0; i + 3 <= text.size(); i++)
+      result.push_back(bucket(p + i));
+}
+
+void RSearchIndex::buckets(const string &text, vector<unsigned int> &result)
+{
+   result.clear();
+   addBuckets(RTextRef(text.data(), text.data() + text.size()), result);
+   sort(result.begin(), result.end());
+   result.erase(unique(result.begin(), result.end()), result.end());
+}
+
+RSearchIndex::RSearchIndex()
+   : _offsets(NULL), _counts(NULL), _postings(NULL), _signatures(NULL),
+     _nameOffsets(NULL), _names(NULL), _packageCount(0), _cacheMtime(0),
+     _cacheSize(0), _languages(0), _map(NULL)
+{
+}
+
+RSearchIndex::~RSearchIndex()
+{
+   clear();
+}
+
+void RSearchIndex::text(RPackage *pkg, pkgRecords &records, Text &text)
+{
+   RSearchIndex::text(pkg->name(), pkg->candidateDescription(), records,
+                      text);
+}
+
+void RSearchIndex::text(const char *name, pkgCache::DescIterator Desc,
+                        pkgRecords &records, Text &text)
+{
+   text.parts[0] = RTextRef(name, name + strlen(name));
+   RPackage::descriptionText(records, Desc, text.parts[1], text.parts[2]);
+}
+
+void RSearchIndex::buckets(const Text &text, vector<unsigned int> &result)
+{
+   result.clear();
+   for (unsigned int i = 0; i < 3; i++)
+      addBuckets(text.parts[i], result);
+   sort(result.begin(), result.end());
+   result.erase(unique(result.begin(), result.end()), result.end());
+}
+
+bool RSearchIndex::contains(const Text &text, const string &word)
+{
+   if (word.empty())
+      return true;
+
+   const unsigned char *w = (const unsigned char *)word.data();
+   unsigned long len = word.size();
+   unsigned char first = foldChar(w[0]);
+   for (unsigned int i = 0; i < 3; i++) {
+      const RTextRef &part = text.parts[i];
+      if (part.size() < len)
+         continue;
+      const unsigned char *p = (const unsigned char *)part.start;
+      const unsigned char *last = (const unsigned char *)part.end - len;
+      for (; p <= last; p++) {
+         if (foldChar(*p) != first)
+            continue;
+         unsigned long k = 1;
+         while (k < len && foldChar(p[k]) == foldChar(w[k]))
+            k++;
+         if (k == len)
+            return true;
+      }
+   }
+   return false;
+}
+
+// changes whenever the text of the package may have changed
+uint32_t RSearchIndex::signature(RPackage *pkg)
+{
+   pkgDepCache *deps = pkg->_lister->getCache()->deps();
+   pkgCache::VerIterator ver = (*deps)[*pkg->package()].CandidateVerIter(*deps);
+   if (ver.end())
+      return 0;
+
+   pkgCache::DescIterator desc = ver.TranslatedDescription();
+   uint32_t hash = fnvHash(2166136261U, ver.VerStr());
+   if (!desc.end()) {
+      hash = fnvHash(hash, desc.md5());
+      hash = fnvHash(hash, desc.LanguageCode());
+   }
+   return hash;
+}
+
+// the descriptions are translated to the first language available
+uint32_t RSearchIndex::languagesHash()
+{
+   vector<string> langs = APT::Configuration::getLanguages();
+   uint32_t hash = 2166136261U;
+   for (unsigned int i = 0; i < langs.size(); i++) {
+      hash = fnvHash(hash, langs[i].c_str());
+      hash = fnvHash(hash, ",");
+   }
+   return hash;
+}
+
+static void putVarint(vector<unsigned char> &out, unsigned int value)
+{
+   while (value >= 0x80) {
+      out.push_back((value & 0x7f) | 0x80);
+      value >>= 7;
+   }
+   out.push_back(value);
+}
+
+static inline unsigned int getVarint(const unsigned char *&p)
+{
+   unsigned int value = 0;
+   unsigned int shift = 0;
+   while (*p & 0x80) {
+      value |= (*p++ & 0x7f) << shift;
+      shift += 7;
+   }
+   value |= *p++ << shift;
+   return value;
+}
+
+RSearchIndexBuilder::RSearchIndexBuilder(const vector<RPackage *> &packages,
+                                         RSearchIndex *old,
+                                         uint64_t cacheMtime,
+                                         uint64_t cacheSize)
+   : _packages(packages), _old(old), _read(0), _cacheMtime(cacheMtime),
+     _cacheSize(cacheSize)
+{
+   _languages = RSearchIndex::languagesHash();
+   unsigned int count = _packages.size();
+
+   // find the packages the old index has with the same text, both
+   // lists are in name order
+   _signatures.resize(count, 0);
+   if (_old != NULL && _old->isComplete() && _old->_languages == _languages)
+      _oldToNew.resize(_old->_packageCount, -1);
+
+   unsigned int j = 0;
+   for (unsigned int i = 0; i < count; i++) {
+      if (_packages[i] == NULL)
+         continue;
+      _signatures[i] = RSearchIndex::signature(_packages[i]);
+      if (_oldToNew.empty()) {
+         _toRead.push_back(i);
+         _descriptions.push_back(_packages[i]->candidateDescription());
+         continue;
+      }
+
+      const char *name = _packages[i]->name();
+      const char *names = _old->_names;
+      const uint32_t *nameOffsets = _old->_nameOffsets;
+      while (j < _old->_packageCount &&
+             strcmp(names + nameOffsets[j], name) < 0)
+         j++;
+      if (j < _old->_packageCount &&
+          strcmp(names + nameOffsets[j], name) == 0 &&
+          _old->_signatures[j] == _signatures[i])
+         _oldToNew[j] = i;
+      else {
+         _toRead.push_back(i);
+         _descriptions.push_back(_packages[i]->candidateDescription());
+      }
+   }
+
+   _lists.resize(RSearchIndex::Buckets);
+   _last.resize(RSearchIndex::Buckets, 0);
+   _counts.resize(RSearchIndex::Buckets, 0);
+
+   if (_config->FindB("Debug::Synaptic::View", false))
+      clog << "RSearchIndexBuilder: " << count << " packages, "
+           << _toRead.size() << " to read" << endl;
+}
+
+RSearchIndexBuilder::~RSearchIndexBuilder()
+{
+   delete _old;
+}
+
+pkgCache *RSearchIndexBuilder::cache()
+{
+   for (unsigned int i = 0; i < _packages.size(); i++) {
+      if (_packages[i] != NULL)
+         return &_packages[i]->_lister->getCache()->deps()->GetCache();
+   }
+   return NULL;
+}
+
+bool RSearchIndexBuilder::step(pkgRecords &records, unsigned int count)
+{
+   vector<unsigned int> pkgBuckets;
+   RSearchIndex::Text text;
+   unsigned int read = _read;
+   for (; read < _toRead.size() && count > 0; read++, count--) {
+      unsigned int i = _toRead[read];
+      RSearchIndex::text(_packages[i]->name(), _descriptions[read], records,
+                         text);
+      RSearchIndex::buckets(text, pkgBuckets);
+      for (unsigned int k = 0; k < pkgBuckets.size(); k++) {
+         unsigned int b = pkgBuckets[k];
+         // the first entry is stored as index + 1, the others as the
+         // distance to the previous one
+         putVarint(_lists[b], i + 1 - _last[b]);
+         _last[b] = i + 1;
+         _counts[b]++;
+      }
+   }
+   _read = read;
+   return !finished();
+}
+
+RSearchIndex *RSearchIndexBuilder::snapshot() const
+{
+   const unsigned int Buckets = RSearchIndex::Buckets;
+   unsigned int count = _packages.size();
+   RSearchIndex *index = new RSearchIndex;
+
+   // merge the entries read with the ones taken over, which keep
+   // their order
+   index->_offsetsV.resize(Buckets + 1);
+   index->_countsV = _counts;
+   vector<unsigned char> &postings = index->_postingsV;
+   postings.reserve(_old != NULL && _old->isBuilt() ?
+                    _old->_offsets[Buckets] : 0);
+   for (unsigned int b = 0; b < Buckets; b++) {
+      index->_offsetsV[b] = postings.size();
+
+      const unsigned char *fresh = _lists[b].empty() ? NULL : &_lists[b][0];
+      const unsigned char *freshEnd = fresh + _lists[b].size();
+      const unsigned char *old = NULL;
+      const unsigned char *oldEnd = NULL;
+      if (!_oldToNew.empty()) {
+         old = _old->_postings + _old->_offsets[b];
+         oldEnd = _old->_postings + _old->_offsets[b + 1];
+      }
+
+      unsigned int freshIndex = 0;
+      unsigned int oldIndex = 0;
+      int nextFresh = -1;
+      int nextOld = -1;
+      unsigned int prev = 0;
+      while (true) {
+         if (nextFresh < 0 && fresh < freshEnd) {
+            freshIndex += getVarint(fresh);
+            nextFresh = freshIndex - 1;
+         }
+         while (nextOld < 0 && old < oldEnd) {
+            oldIndex += getVarint(old);
+            nextOld = _oldToNew[oldIndex - 1];
+         }
+         if (nextFresh < 0 && nextOld < 0)
+            break;
+
+         unsigned int i;
+         if (nextOld < 0 || (nextFresh >= 0 && nextFresh < nextOld)) {
+            i = nextFresh;
+            nextFresh = -1;
+         } else {
+            i = nextOld;
+            nextOld = -1;
+            index->_countsV[b]++;
+         }
+         putVarint(postings, i + 1 - prev);
+         prev = i + 1;
+      }
+   }
+   index->_offsetsV[Buckets] = postings.size();
+
+   index->_nameOffsetsV.resize(count + 1);
+   for (unsigned int i = 0; i < count; i++) {
+      index->_nameOffsetsV[i] = index->_namesV.size();
+      const char *name = _packages[i] != NULL ? _packages[i]->name() : "";
+      index->_namesV.insert(index->_namesV.end(), name,
+                            name + strlen(name) + 1);
+   }
+   index->_nameOffsetsV[count] = index->_namesV.size();
+   index->_signaturesV = _signatures;
+
+   for (unsigned int i = _read; i < _toRead.size(); i++)
+      index->_pending.set(_toRead[i]);
+
+   index->usePackageVectors();
+   index->_packageCount = count;
+   index->_cacheMtime = _cacheMtime;
+   index->_cacheSize = _cacheSize;
+   index->_languages = _languages;
+   return index;
+}
+
+void RSearchIndex::usePackageVectors()
+{
+   _offsets = &_offsetsV[0];
+   _counts = &_countsV[0];
+   _postings = _postingsV.empty() ? NULL : &_postingsV[0];
+   _signatures = _signaturesV.empty() ? NULL : &_signaturesV[0];
+   _nameOffsets = &_nameOffsetsV[0];
+   _names = _namesV.empty() ? NULL : &_namesV[0];
+}
+
+void RSearchIndex::clear()
+{
+   _offsets = NULL;
+   _counts = NULL;
+   _postings = NULL;
+   _signatures = NULL;
+   _nameOffsets = NULL;
+   _names = NULL;
+   _offsetsV.clear();
+   _countsV.clear();
+   _postingsV.clear();
+   _signaturesV.clear();
+   _nameOffsetsV.clear();
+   _namesV.clear();
+   _pending.clear();
+   delete _map;
+   _map = NULL;
+   _packageCount = 0;
+}
+
+bool RSearchIndex::isCurrent(uint64_t cacheMtime, uint64_t cacheSize) const
+{
+   return isComplete() && _cacheMtime == cacheMtime &&
+          _cacheSize == cacheSize && _languages == languagesHash();
+}
+
+// every name ends in its own range of names
+bool RSearchIndex::validPackages(const uint32_t *nameOffsets,
+                                 const char *names, unsigned int count,
+                                 uint32_t namesSize)
+{
+   if (nameOffsets[0] != 0 || nameOffsets[count] > namesSize)
+      return false;
+   for (unsigned int i = 0; i < count; i++) {
+      if (nameOffsets[i + 1] <= nameOffsets[i] ||
+          names[nameOffsets[i + 1] - 1] != 0)
+         return false;
+   }
+   return true;
+}
+
+// the buckets follow each other, and their entries stay inside them
+// and name packages of the index
+bool RSearchIndex::validPostings(const uint32_t *offsets,
+                                 const unsigned char *postings,
+                                 unsigned int count, uint32_t postingsSize)
+{
+   if (offsets[0] != 0 || offsets[Buckets] != postingsSize)
+      return false;
+   for (unsigned int b = 0; b < Buckets; b++) {
+      if (offsets[b + 1] < offsets[b])
+         return false;
+
+      const unsigned char *p = postings + offsets[b];
+      const unsigned char *end = postings + offsets[b + 1];
+      uint64_t index = 0;
+      while (p < end) {
+         // getVarint() without reading past the bucket
+         uint64_t value = 0;
+         unsigned int shift = 0;
+         while (p < end && (*p & 0x80) && shift < 28) {
+            value |= (uint64_t)(*p++ & 0x7f) << shift;
+            shift += 7;
+         }
+         if (p == end || (*p & 0x80))
+            return false;
+         value |= (uint64_t)*p++ << shift;
+
+         index += value;
+         if (value == 0 || index > count)
+            return false;
+      }
+   }
+   return true;
+}
+
+bool RSearchIndex::load(const string &file)
+{
+   if (!FileExists(file))
+      return false;
+
+   FileFd File(file, FileFd::ReadOnly);
+   MMap *map = NULL;
+   if (!_error->PendingError())
+      map = new MMap(File, MMap::ReadOnly);
+   if (_error->PendingError()) {
+      // an unreadable index is rebuilt, nothing to complain about
+      _error->Discard();
+      delete map;
+      return false;
+   }
+
+   const char *data = (const char *)map->Data();
+   uint64_t size = map->Size();
+   const indexHeader *header = (const indexHeader *)data;
+   if (size < sizeof(indexHeader) ||
+       memcmp(header->magic, IndexMagic, sizeof(header->magic)) != 0 ||
+       header->version != IndexVersion || header->buckets != Buckets) {
+      delete map;
+      return false;
+   }
+
+   uint64_t count = header->packageCount;
+   uint64_t arrays = (Buckets + 1) + Buckets + count + (count + 1);
+   uint64_t needed = sizeof(indexHeader) + arrays * sizeof(uint32_t) +
+                     header->namesSize + header->postingsSize;
+   if (size < needed) {
+      delete map;
+      return false;
+   }
+
+   const uint32_t *p = (const uint32_t *)(data + sizeof(indexHeader));
+   const uint32_t *offsets = p;
+   p += Buckets + 1;
+   const uint32_t *counts = p;
+   p += Buckets;
+   const uint32_t *signatures = p;
+   p += count;
+   const uint32_t *nameOffsets = p;
+   p += count + 1;
+   const char *names = (const char *)p;
+   const unsigned char *postings =
+      (const unsigned char *)names + header->namesSize;
+
+   // the file may have been changed by anyone, everything that is
+   // looked up has to be in there
+   if (!validPackages(nameOffsets, names, count, header->namesSize) ||
+       !validPostings(offsets, postings, count, header->postingsSize)) {
+      delete map;
+      return false;
+   }
+
+   clear();
+   _map = map;
+   _offsets = offsets;
+   _counts = counts;
+   _signatures = signatures;
+   _nameOffsets = nameOffsets;
+   _names = names;
+   _postings = postings;
+
+   _packageCount = count;
+   _cacheMtime = header->cacheMtime;
+   _cacheSize = header->cacheSize;
+   _languages = header->languages;
+   return true;
+}
+
+bool RSearchIndex::save(const string &file) const
+{
+   if (!isComplete())
+      return false;
+
+   indexHeader header;
+   memset(&header, 0, sizeof(header));
+   memcpy(header.magic, IndexMagic, sizeof(header.magic));
+   header.version = IndexVersion;
+   header.buckets = Buckets;
+   header.cacheMtime = _cacheMtime;
+   header.cacheSize = _cacheSize;
+   header.languages = _languages;
+   header.packageCount = _packageCount;
+   header.namesSize = _nameOffsets[_packageCount];
+   header.postingsSize = _offsets[Buckets];
+
+   // written next to it and renamed, so a reader never sees half of it
+   string tmp = file + ".new";
+   ofstream out(tmp.c_str(), ios::binary);
+   if (!out)
+      return false;
+   out.write((const char *)&header, sizeof(header));
+   out.write((const char *)_offsets, (Buckets + 1) * sizeof(uint32_t));
+   out.write((const char *)_counts, Buckets * sizeof(uint32_t));
+   out.write((const char *)_signatures, _packageCount * sizeof(uint32_t));
+   out.write((const char *)_nameOffsets,
+             (_packageCount + 1) * sizeof(uint32_t));
+   out.write(_names, header.namesSize);
+   out.write((const char *)_postings, header.postingsSize);
+   out.close();
+   if (!out || rename(tmp.c_str(), file.c_str()) != 0) {
+      unlink(tmp.c_str());
+      return false;
+   }
+   return true;
+}
+
+void RSearchIndex::getBucket(unsigned int b, RPackageSet &set) const
+{
+   const unsigned char *p = _postings + _offsets[b];
+   const unsigned char *end = _postings + _offsets[b + 1];
+
+   unsigned int index = 0;
+   while (p < end) {
+      index += getVarint(p);
+      set.set(index - 1);
+   }
+}
+
+struct bucketSizeLess {
+   const uint32_t *_counts;
+   bucketSizeLess(const uint32_t *counts) : _counts(counts) {}
+   bool operator() (unsigned int x, unsigned int y) {
+      return _counts[x] < _counts[y];
+   }
+};
+
+bool RSearchIndex::candidates(const vector<string> &words,
+                              RPackageSet &result) const
+{
+   if (!isBuilt())
+      return false;
+
+   vector<unsigned int> all;
+   vector<unsigned int> wordBuckets;
+   for (unsigned int i = 0; i < words.size(); i++) {
+      buckets(words[i], wordBuckets);
+      all.insert(all.end(), wordBuckets.begin(), wordBuckets.end());
+   }
+   if (all.empty())
+      return false;
+
+   // start with the shortest lists, the result only gets smaller
+   sort(all.begin(), all.end());
+   all.erase(unique(all.begin(), all.end()), all.end());
+   sort(all.begin(), all.end(), bucketSizeLess(_counts));
+
+   result.clear();
+   getBucket(all[0], result);
+   for (unsigned int i = 1; i < all.size() && !result.empty(); i++) {
+      RPackageSet set;
+      getBucket(all[i], set);
+      result.intersect(set);
+   }
+   result.unite(_pending);
+   return true;
+}
+
+// vim:ts=3:sw=3:et
@@ -0,0 +1,176 @@
+/* rsearchindex.h - trigram index of the package texts
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RSEARCHINDEX_H
+#define RSEARCHINDEX_H
+
+#include <vector>
+#include <string>
+#include <stdint.h>
+
+#include <apt-pkg/mmap.h>
+#include <apt-pkg/pkgrecords.h>
+#include <apt-pkg/progress.h>
+
+#include "rpackage.h"
+#include "rpackageset.h"
+
+using namespace std;
+
+// For every three characters (case folded) that occur in the name,
+// summary or description of a package, the packages they occur in.
+// A word can only be in the text of a package that has all of its
+// trigrams, so intersecting their lists gives the few packages worth
+// looking at. Trigrams are hashed into a fixed number of lists; a
+// collision only adds candidates, the caller checks them anyway.
+//
+// The index can be saved to a file and mapped back in, it remembers
+// the package cache it was built for.
+class RSearchIndex {
+ protected:
+   static const unsigned int BucketBits = 18;
+   static const unsigned int Buckets = 1 << BucketBits;
+
+   // the package indexes of each bucket, as delta encoded varints,
+   // bucket i is _postings[_offsets[i]] to _postings[_offsets[i + 1]]
+   const uint32_t *_offsets;
+   const uint32_t *_counts;
+   const unsigned char *_postings;
+
+   // name and description signature of each package, to find the
+   // packages that can be taken over when the cache changed
+   const uint32_t *_signatures;
+   const uint32_t *_nameOffsets;
+   const char *_names;
+
+   unsigned int _packageCount;
+   // packages the index knows nothing about yet
+   RPackageSet _pending;
+   uint64_t _cacheMtime;
+   uint64_t _cacheSize;
+   uint32_t _languages;
+
+   // the arrays point either into these or into the mapped file
+   vector<uint32_t> _offsetsV;
+   vector<uint32_t> _countsV;
+   vector<unsigned char> _postingsV;
+   vector<uint32_t> _signaturesV;
+   vector<uint32_t> _nameOffsetsV;
+   vector<char> _namesV;
+   MMap *_map;
+
+   static unsigned int bucket(const unsigned char *p);
+   static void addBuckets(const RTextRef &text, vector<unsigned int> &result);
+   static void buckets(const string &text, vector<unsigned int> &result);
+   static uint32_t signature(RPackage *pkg);
+   static uint32_t languagesHash();
+   void getBucket(unsigned int b, RPackageSet &set) const;
+   static bool validPackages(const uint32_t *nameOffsets, const char *names,
+                             unsigned int count, uint32_t namesSize);
+   static bool validPostings(const uint32_t *offsets,
+                             const unsigned char *postings,
+                             unsigned int count, uint32_t postingsSize);
+   void usePackageVectors();
+
+   friend class RSearchIndexBuilder;
+
+ public:
+   // the text that is indexed and searched for a package: the name,
+   // the summary and the rest of the description, pointing into the
+   // buffer of the records until their next lookup
+   struct Text {
+      RTextRef parts[3];
+   };
+   static void text(RPackage *pkg, pkgRecords &records, Text &text);
+   // the same with the description already looked up, see
+   // RPackage::candidateDescription()
+   static void text(const char *name, pkgCache::DescIterator Desc,
+                    pkgRecords &records, Text &text);
+   static void buckets(const Text &text, vector<unsigned int> &result);
+   // ignores the case like strcasestr()
+   static bool contains(const Text &text, const string &word);
+
+   void clear();
+   bool isBuilt() const { return _offsets != NULL; }
+   bool isComplete() const { return isBuilt() && _pending.empty(); }
+   bool isCurrent(uint64_t cacheMtime, uint64_t cacheSize) const;
+
+   // replaces the index with the one in file, keeps the current one
+   // if the file can not be used
+   bool load(const string &file);
+   bool save(const string &file) const;
+
+   // the packages whose text may contain all of words (including the
+   // ones not indexed yet), false if none of the words is long enough
+   // to say anything
+   bool candidates(const vector<string> &words, RPackageSet &result) const;
+
+   RSearchIndex();
+   ~RSearchIndex();
+};
+
+// Builds an index a few packages at a time, so that it can be done in
+// the background and looked at before it is finished. The packages
+// whose text did not change are taken over from an older index.
+class RSearchIndexBuilder {
+ protected:
+   vector<RPackage *> _packages;
+   RSearchIndex *_old;
+   vector<int> _oldToNew;
+   vector<uint32_t> _signatures;
+
+   // the packages that have to be read, and how many of them are;
+   // their descriptions are looked up by the constructor, step() may
+   // run on another thread while the package state changes
+   volatile unsigned int _read;
+   vector<unsigned int> _toRead;
+   vector<pkgCache::DescIterator> _descriptions;
+
+   // their entries so far, encoded like the ones of the index
+   vector<vector<unsigned char> > _lists;
+   vector<unsigned int> _last;
+   vector<uint32_t> _counts;
+
+   uint64_t _cacheMtime;
+   uint64_t _cacheSize;
+   uint32_t _languages;
+
+ public:
+   // packages must be in RPackage::index() order, cacheMtime and
+   // cacheSize identify the package cache; old (which may be NULL) is
+   // owned by the builder from now on
+   RSearchIndexBuilder(const vector<RPackage *> &packages, RSearchIndex *old,
+                       uint64_t cacheMtime, uint64_t cacheSize);
+   ~RSearchIndexBuilder();
+
+   // reads up to count more packages through records, false once all
+   // are read; only looks at records and the package names
+   bool step(pkgRecords &records, unsigned int count);
+   bool finished() const { return _read == _toRead.size(); }
+   unsigned int done() const { return _read; }
+   unsigned int total() const { return _toRead.size(); }
+
+   // a new index of what is known so far
+   RSearchIndex *snapshot() const;
+
+   pkgCache *cache();
+};
+
+#endif
+
+// vim:ts=3:sw=3:et
@@ -0,0 +1,187 @@
+/* rsearchindexer.cc - builds the search index in the background
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#include <iostream>
+
+#include <apt-pkg/configuration.h>
+#include <apt-pkg/pkgrecords.h>
+
+#include "rsearchindexer.h"
+#include "i18n.h"
+
+// packages read between two checks for cancelling, and between two
+// published indexes
+static const unsigned int StepSize = 500;
+static const unsigned int PublishSteps = 20;
+
+RSearchIndexer::RSearchIndexer()
+   : _running(false), _cancel(false), _debug(false), _builder(NULL),
+     _records(NULL), _current(NULL), _ready(NULL)
+{
+   pthread_mutex_init(&_lock, NULL);
+}
+
+RSearchIndexer::~RSearchIndexer()
+{
+   stop();
+   pthread_mutex_destroy(&_lock);
+}
+
+void RSearchIndexer::setIndex(RSearchIndex *index)
+{
+   stop();
+   _current = index;
+}
+
+void RSearchIndexer::start(RSearchIndexBuilder *builder,
+                           const vector<string> &files, bool background)
+{
+   stop();
+   _files = files;
+   _cancel = false;
+   _debug = _config->FindB("Debug::Synaptic::View", false);
+
+   // everything was taken over, only the cache it is for changed
+   if (builder->finished()) {
+      _current = builder->snapshot();
+      finish(_current);
+      delete builder;
+      return;
+   }
+
+   _builder = builder;
+   if (background) {
+      // pkgRecords reads the configuration, which the main thread may
+      // change later on
+      _records = new pkgRecords(*_builder->cache());
+      if (pthread_create(&_thread, NULL, run, this) == 0) {
+         _running = true;
+      } else {
+         cerr << "could not start the search indexer" << endl;
+         delete _records;
+         _records = NULL;
+      }
+   }
+}
+
+void RSearchIndexer::stop()
+{
+   if (_running) {
+      _cancel = true;
+      pthread_join(_thread, NULL);
+      _running = false;
+   }
+
+   delete _records;
+   _records = NULL;
+   delete _builder;
+   _builder = NULL;
+   delete _ready;
+   _ready = NULL;
+   delete _current;
+   _current = NULL;
+}
+
+void RSearchIndexer::publish(RSearchIndex *index)
+{
+   pthread_mutex_lock(&_lock);
+   // the main thread never saw the one before, it can go
+   delete _ready;
+   _ready = index;
+   pthread_mutex_unlock(&_lock);
+}
+
+// saves the finished index
+void RSearchIndexer::finish(RSearchIndex *index)
+{
+   for (unsigned int i = 0; i < _files.size(); i++) {
+      if (index->save(_files[i]))
+         return;
+   }
+   cerr << "could not save the search index" << endl;
+}
+
+void *RSearchIndexer::run(void *data)
+{
+   RSearchIndexer *me = (RSearchIndexer *)data;
+   RSearchIndexBuilder *builder = me->_builder;
+
+   // what can be taken over from the old index is there right away
+   me->publish(builder->snapshot());
+
+   unsigned int steps = 0;
+   while (!me->_cancel && builder->step(*me->_records, StepSize)) {
+      if (++steps % PublishSteps == 0)
+         me->publish(builder->snapshot());
+   }
+   if (me->_cancel)
+      return NULL;
+
+   RSearchIndex *index = builder->snapshot();
+   me->finish(index);
+   me->publish(index);
+
+   if (me->_debug)
+      clog << "RSearchIndexer: done" << endl;
+   return NULL;
+}
+
+RSearchIndex *RSearchIndexer::index(OpProgress *progress)
+{
+   // not built in the background, do it now
+   if (!_running && _builder != NULL) {
+      if (progress != NULL)
+         progress->OverallProgress(0, _builder->total(), 1,
+                                   _("Building search index"));
+      pkgRecords records(*_builder->cache());
+      while (_builder->step(records, StepSize)) {
+         if (progress != NULL)
+            progress->Progress(_builder->done());
+      }
+      if (progress != NULL)
+         progress->Done();
+
+      delete _current;
+      _current = _builder->snapshot();
+      finish(_current);
+      delete _builder;
+      _builder = NULL;
+   }
+
+   pthread_mutex_lock(&_lock);
+   if (_ready != NULL) {
+      delete _current;
+      _current = _ready;
+      _ready = NULL;
+   }
+   pthread_mutex_unlock(&_lock);
+
+   return _current;
+}
+
+bool RSearchIndexer::getProgress(unsigned int &done, unsigned int &total)
+{
+   // without a thread nothing happens until the first search
+   if (!_running || _builder == NULL || _builder->finished())
+      return false;
+   done = _builder->done();
+   total = _builder->total();
+   return true;
+}
+
+// vim:ts=3:sw=3:et
@@ -0,0 +1,84 @@
+/* rsearchindexer.h - builds the search index in the background
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307
+ * USA
+ */
+
+#ifndef RSEARCHINDEXER_H
+#define RSEARCHINDEXER_H
+
+#include <pthread.h>
+#include <vector>
+#include <string>
+
+#include <apt-pkg/progress.h>
+#include <apt-pkg/pkgrecords.h>
+
+#include "rsearchindex.h"
+
+using namespace std;
+
+// Owns the search index of the lister. An RSearchIndexBuilder handed
+// to start() is run on a thread of its own, which publishes what it
+// has every now and then; index() swaps the newest one in. The index
+// returned stays valid until the next index() or stop() call, all of
+// this is only called from the main thread.
+class RSearchIndexer {
+ protected:
+   pthread_t _thread;
+   pthread_mutex_t _lock;
+   bool _running;
+   volatile bool _cancel;
+   bool _debug;
+
+   RSearchIndexBuilder *_builder;
+   // the records of the thread, set up before it starts
+   pkgRecords *_records;
+   vector<string> _files;
+
+   RSearchIndex *_current;
+   RSearchIndex *_ready;        // published by the thread, under _lock
+
+   static void *run(void *data);
+   void publish(RSearchIndex *index);
+   void finish(RSearchIndex *index);
+
+ public:
+   // use an index that is already complete
+   void setIndex(RSearchIndex *index);
+
+   // builds the index from builder, which is owned by the indexer now,
+   // and saves it to the first of files that can be written; without
+   // background this happens on the first index() call
+   void start(RSearchIndexBuilder *builder, const vector<string> &files,
+              bool background);
+
+   // cancels the building and drops the index, the packages it was
+   // built from may go away after this
+   void stop();
+
+   // NULL if there is nothing yet
+   RSearchIndex *index(OpProgress *progress = NULL);
+
+   // false if no index is being built in the background
+   bool getProgress(unsigned int &done, unsigned int &total);
+
+   RSearchIndexer();
+   ~RSearchIndexer();
+};
+
+#endif
+
+// vim:ts=3:sw=3:et
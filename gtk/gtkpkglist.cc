@@ -104,46 +104,38 @@ void RCacheActorPkgList::run(vector<RPackage *> &List, int Action)
 
 }
 
-void RPackageListActorPkgList::run(vector<RPackage *> &List, int listEvent)
+void RPackageListActorPkgList::run(vector<int> &rows, int listEvent)
 {
-   cout <<
-      "RPackageListActorPkgList::run(vector<RPackage*> &List, int pkgEvent)" <<
-      endl;
-
-   cout << "action: " << listEvent << endl;
-   cout << "listsize: " << List.size() << endl;
-
-   //_pkgList = gtk_pkg_list_new(_lister);
-   //gtk_tree_view_set_model(GTK_TREE_VIEW(_pkgView),
-   //                        GTK_TREE_MODEL(_pkgList));
-   //return;
-
-   //mvo: FIXME those nested loops suck as they are slow
-   if (listEvent == PKG_REMOVED) {
-      for (int i = (int)List.size() - 1; i >= 0; i--) {
-         int j;
-         for (j = 0; j < (int)_lastDisplayList.size(); j++)
-            if (_lastDisplayList[j] == List[i])
-               break;
-         cout << "Removed at pos: " << j << endl;
-         GtkTreePath *path = gtk_tree_path_new();
-         gtk_tree_path_append_index(path, j);
-         gtk_tree_model_row_deleted(GTK_TREE_MODEL(_pkgList), path);
-         gtk_tree_path_free(path);
-      }
-   } else if (listEvent == PKG_ADDED) {
-      static GtkTreeIter iter;
-      for (int i = 0; i < (int)List.size(); i++) {
-         int j = _lister->getViewPackageIndex(List[i]);
-         cout << "Inserted " << List[i]->name() << " at pos: " << j << endl;
-         GtkTreePath *path = gtk_tree_path_new();
-         gtk_tree_path_append_index(path, j);
-         iter.user_data = List[i];
-         iter.user_data2 = GINT_TO_POINTER(j);
-         iter.stamp = 140677;
-         gtk_tree_model_row_inserted(GTK_TREE_MODEL(_pkgList), path, &iter);
-         gtk_tree_path_free(path);
+#ifdef DEBUG_LIST
+   cout << "RPackageListActorPkgList::run(): event " << listEvent
+        << ", " << rows.size() << " rows" << endl;
+#endif
+
+   GtkTreeModel *model = GTK_TREE_MODEL(_pkgList);
+
+   if (listEvent == PKG_REORDERED) {
+      GtkTreePath *path = gtk_tree_path_new();
+      gtk_tree_model_rows_reordered(model, path, NULL, &rows[0]);
+      gtk_tree_path_free(path);
+      return;
+   }
+
+   GtkTreeIter iter;
+   iter.stamp = 140677;
+   for (unsigned int i = 0; i < rows.size(); i++) {
+      GtkTreePath *path = gtk_tree_path_new();
+      gtk_tree_path_append_index(path, rows[i]);
+      if (listEvent == PKG_REMOVED) {
+         gtk_tree_model_row_deleted(model, path);
+      } else {
+         iter.user_data = _lister->getViewPackage(rows[i]);
+         iter.user_data2 = GINT_TO_POINTER(rows[i]);
+         if (listEvent == PKG_ADDED)
+            gtk_tree_model_row_inserted(model, path, &iter);
+         else
+            gtk_tree_model_row_changed(model, path, &iter);
       }
+      gtk_tree_path_free(path);
    }
 }
 
@@ -404,6 +396,7 @@ gtk_pkg_list_get_value(GtkTreeModel *tree_model,
       return;
    }
 
+   RPackageColumns *columns = pkg_list->_lister->getColumns();
    const gchar *str;
    switch (column) {
       case NAME_COLUMN:
@@ -411,35 +404,35 @@ gtk_pkg_list_get_value(GtkTreeModel *tree_model,
          g_value_set_string(value, str);
          break;
       case PKG_SIZE_COLUMN:
-         if (pkg->installedVersion()) {
-            str = SizeToStr(pkg->installedSize()).c_str();
-            g_value_set_string(value, str);
+         if (columns->installedVersion(pkg)) {
+            g_value_set_string(value,
+                               SizeToStr(columns->installedSize(pkg)).c_str());
          }
          break;
       case PKG_DOWNLOAD_SIZE_COLUMN:
-	 str = SizeToStr(pkg->availablePackageSize()).c_str();
-	 g_value_set_string(value, str);
+	 g_value_set_string(value,
+			    SizeToStr(columns->availablePackageSize(pkg)).c_str());
          break;
       case SECTION_COLUMN:
-	 str = pkg->section();
+	 str = columns->section(pkg);
 	 if(str != NULL)
 	    g_value_set_string(value, str);
 	 break;
       case COMPONENT_COLUMN:
-	 str = pkg->component().c_str();
+	 str = columns->component(pkg);
 	 if(str)
 	    g_value_set_string(value, str);
 	 break;
       case INSTALLED_VERSION_COLUMN:
-         str = pkg->installedVersion();
+         str = columns->installedVersion(pkg);
          g_value_set_string(value, str);
          break;
       case AVAILABLE_VERSION_COLUMN:
-         str = pkg->availableVersion();
+         str = columns->availableVersion(pkg);
          g_value_set_string(value, str);
          break;
       case DESCR_COLUMN:
-         str = utf8(pkg->summary());
+         str = utf8(columns->summary(pkg));
          g_value_set_string(value, str);
          break;
       case PKG_COLUMN:
@@ -85,7 +85,7 @@ class RPackageListActorPkgList:public RPackageListActor {
 
    public:
 
-   virtual void run(vector<RPackage *> &List, int listEvent);
+   virtual void run(vector<int> &rows, int listEvent);
 
    RPackageListActorPkgList(RPackageLister *lister,
                             GtkPkgList *pkgList,
@@ -46,6 +46,7 @@
 //  Dependent Packages
 //  Origin
 //  Component
+//  Pulled In By
 
 RGFilterManagerWindow::RGFilterManagerWindow(RGWindow *win,
                                              RPackageViewFilter *filterview)
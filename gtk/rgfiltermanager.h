@@ -79,6 +79,7 @@ static char *DepOptions[] = {
    _("Dependent packages"),   // Reverse Depends
    _("Origin"),                 // Origin (e.g. security.debian.org)
    _("Component"),                 // Component (e.g. main, universe)
+   _("Pulled in by"),           // dependencies, direct or not
    NULL
 };
 
@@ -90,6 +90,7 @@ const char *relOptions[] = {
    N_("Dependants"),
    N_("Dependencies of the Latest Version"),
    N_("Provided Packages"),
+   N_("Installed Because Of"),
    NULL
 };
 
@@ -667,7 +668,7 @@ void RGMainWindow::pkgAction(RGPkgAction action)
    int flags;
 
    while (li != NULL) {
-      pkgDepCache::ActionGroup group(*_lister->getCache()->deps());
+      RActionGroup group(_lister);
       gtk_tree_model_get_iter(_pkgList, &iter, (GtkTreePath *) (li->data));
       gtk_tree_model_get(_pkgList, &iter, PKG_COLUMN, &pkg, -1);
       li = g_list_next(li);
@@ -798,7 +799,7 @@ RGMainWindow::RGMainWindow(RPackageLister *packLister, string name)
    : RGGtkBuilderWindow(NULL, name), _lister(packLister), _pkgList(0), 
      _treeView(0), _tasksWin(0), _iconLegendPanel(0), _pkgDetails(0),
      _logView(0), _installProgress(0), _fetchProgress(0), 
-     _fastSearchEventID(-1)
+     _fastSearchEventID(-1), _searchIndexShown(false), _searchIndexTimer(0)
 {
    assert(_win);
 
@@ -807,6 +808,7 @@ RGMainWindow::RGMainWindow(RPackageLister *packLister, string name)
    _interfaceLocked = 0;
 
    _lister->registerObserver(this);
+   _lister->registerCacheObserver(this);
 
    _toolbarStyle = (GtkToolbarStyle) _config->FindI("Synaptic::ToolbarState",
                                                     (int)GTK_TOOLBAR_BOTH);
@@ -1567,21 +1569,8 @@ void RGMainWindow::buildInterface()
    _entry_fast_search = GTK_WIDGET(gtk_builder_get_object
                                    (_builder, "entry_fast_search"));
 
-   // only enable fast search if its usable
-#ifdef WITH_EPT
-   if(!_lister->xapiandatabase() ||
-      !FileExists("/usr/sbin/update-apt-xapian-index")) {
-      gtk_widget_hide(GTK_WIDGET(
-            gtk_builder_get_object(_builder, "toolitem_fast_search")));
-      gtk_box_set_center_widget(GTK_BOX(
-            gtk_builder_get_object(_builder, "hbox_button_toolbar")), NULL);
-   }
-#else
-   gtk_widget_hide(GTK_WIDGET(
-         gtk_builder_get_object(_builder, "toolitem_fast_search")));
-   gtk_box_set_center_widget(GTK_BOX(
-         gtk_builder_get_object(_builder, "hbox_button_toolbar")), NULL);
-#endif
+   // the fast search uses the xapian index when there is one and the
+   // built in search index otherwise, so it is always usable
    // stuff for the non-root mode
    if(getuid() != 0) {
       GtkWidget *menu;
@@ -1685,6 +1674,13 @@ void RGMainWindow::setStatusText(char *text)
                             ("%i packages listed, %i installed, %i broken. %i to install/upgrade, %i to remove"),
                             listed, installed, broken, toInstall, toRemove);
       }
+      unsigned int done, total;
+      if (_lister->getSearchIndexProgress(done, total) && total > 0) {
+         gchar *progress = g_strdup_printf(_("%s (building search index: %u%%)"),
+                                           buffer, done * 100 / total);
+         g_free(buffer);
+         buffer = progress;
+      }
       gtk_label_set_text(GTK_LABEL(_statusL), buffer);
       g_free(buffer);
    }
@@ -2645,9 +2641,7 @@ void RGMainWindow::cbProceedClicked(GtkWidget *self, void *data)
       return;
    }
 
-   int a,b,c,d,e,f,g,h,unAuthenticated;
-   double s;
-   me->_lister->getSummary(a,b,c,d,e,f,g,h,unAuthenticated,s);
+   int unAuthenticated = me->_lister->getChangeSet().unauthenticated;
    if(unAuthenticated ||
       _config->FindB("Volatile::Non-Interactive", false) == false) {
       // show a summary of what's gonna happen
@@ -2822,6 +2816,34 @@ gboolean RGMainWindow::xapianDoSearch(void *data)
    return FALSE;
 }
 
+gboolean RGMainWindow::searchIndexProgress(void *data)
+{
+   RGMainWindow *me = (RGMainWindow *) data;
+   unsigned int done, total;
+
+   // busy with something else, e.g. reopening the cache
+   if (me->_interfaceLocked > 0)
+      return TRUE;
+
+   // only touch the status bar while the index is built, and once more
+   // when it is done; notifyCacheOpen() starts over
+   bool building = me->_lister->getSearchIndexProgress(done, total);
+   if (building || me->_searchIndexShown)
+      me->setStatusText();
+   me->_searchIndexShown = building;
+   if (building)
+      return TRUE;
+
+   me->_searchIndexTimer = 0;
+   return FALSE;
+}
+
+void RGMainWindow::notifyCacheOpen()
+{
+   if (_searchIndexTimer == 0)
+      _searchIndexTimer = g_timeout_add_seconds(1, searchIndexProgress, this);
+}
+
 void RGMainWindow::cbSearchEntryChanged(GtkWidget *edit, void *data)
 {
    //cerr << "RGMainWindow::cbSearchEntryChanged()" << endl;
@@ -2830,7 +2852,12 @@ void RGMainWindow::cbSearchEntryChanged(GtkWidget *edit, void *data)
       g_source_remove(me->_fastSearchEventID);
       me->_fastSearchEventID = -1;
    }
-   me->_fastSearchEventID = g_timeout_add(500, xapianDoSearch, me);
+   // searches that extend the last one only narrow its results down,
+   // so they are cheap enough to follow the typing closely; xapian
+   // runs the whole query every time, give it the old delay
+   int delay = _config->FindI("Synaptic::SearchDelay",
+                              me->_lister->usesXapianSearch() ? 500 : 100);
+   me->_fastSearchEventID = g_timeout_add(delay, xapianDoSearch, me);
 }
 
 void RGMainWindow::cbUpdateClicked(GtkWidget *self, void *data)
@@ -2989,8 +3016,6 @@ void RGMainWindow::cbUpgradeClicked(GtkWidget *self, void *data)
    me->setInterfaceLocked(TRUE);
    me->setStatusText(_("Marking all available upgrades..."));
 
-   me->_lister->saveUndoState();
-   
    RPackageLister::pkgState state;
    me->_lister->saveState(state);
 
@@ -3001,6 +3026,7 @@ void RGMainWindow::cbUpgradeClicked(GtkWidget *self, void *data)
 
    if(me->askStateChange(state))
    {
+      me->_lister->saveUndoState(state);
       me->refreshTable(pkg);
 
       if (res)
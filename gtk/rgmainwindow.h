@@ -69,7 +69,8 @@ typedef enum {
 
 extern const char *relOptions[];
 
-class RGMainWindow : public RGGtkBuilderWindow, public RPackageObserver {
+class RGMainWindow : public RGGtkBuilderWindow, public RPackageObserver,
+                     public RCacheObserver {
 
    typedef enum {
       UPGRADE_ASK = -1,
@@ -136,6 +137,9 @@ class RGMainWindow : public RGGtkBuilderWindow, public RPackageObserver {
 
    // fast search stuff
    int _fastSearchEventID;
+   bool _searchIndexShown;
+   // the timer of searchIndexProgress(), 0 while it is not running
+   guint _searchIndexTimer;
    GtkWidget *_entry_fast_search;
    static GtkCssProvider *_fastSearchCssProvider;
 
@@ -185,6 +189,8 @@ class RGMainWindow : public RGGtkBuilderWindow, public RPackageObserver {
    static void xapianIndexUpdateFinished(GPid pid, gint status, void* data);
    static gboolean xapianDoSearch(void *data);
    static gboolean xapianDoIndexUpdate(void *data);
+   // shows the progress of the built in search index
+   static gboolean searchIndexProgress(void *data);
 
    // RPackageObserver
    virtual void notifyChange(RPackage *pkg);
@@ -193,6 +199,13 @@ class RGMainWindow : public RGGtkBuilderWindow, public RPackageObserver {
    virtual void notifyPostFilteredChange() {
    };
 
+   // RCacheObserver, the search index is built anew on every open
+   virtual void notifyCacheOpen();
+   virtual void notifyCachePreChange() {
+   };
+   virtual void notifyCachePostChange() {
+   };
+
  public:
    RGMainWindow(RPackageLister *packLister, string name);
    virtual ~RGMainWindow() {};
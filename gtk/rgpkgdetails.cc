@@ -29,6 +29,7 @@
 #include "rgpkgdetails.h"
 #include "rggtkbuilderwindow.h"
 #include "rpackage.h"
+#include "rpackagelister.h"
 #include "rgpackagestatus.h"
 #include "rgchangelogdialog.h"
 #include "sections_trans.h"
@@ -123,6 +124,57 @@ RGPkgDetailsWindow::formatDepInformation(vector<DepInformation> deps)
    return depStrings;
 }
 
+// the chain of dependencies that keeps the package installed and what
+// removing it would take along
+vector<string>
+RGPkgDetailsWindow::formatWhyInstalled(RPackage *pkg)
+{
+   vector<string> lines;
+   int flags = pkg->getFlags();
+
+   if (!(flags & RPackage::FInstalled)) {
+      lines.push_back(_("This package is not installed"));
+      return lines;
+   }
+
+   vector<RPackage *> path;
+   vector<int> types;
+   if (!(flags & RPackage::FIsAuto)) {
+      lines.push_back(_("This package was installed manually"));
+   } else if (pkg->_lister->getWhyInstalled(pkg, path, types)) {
+      lines.push_back(string(path[0]->name()) + " " +
+                      _("<i>(installed manually)</i>"));
+      for (unsigned int i = 1; i < path.size(); i++) {
+         const char *type;
+         switch (types[i - 1]) {
+         case RDependencyGraph::PreDepends:
+            type = _("PreDepends");
+            break;
+         case RDependencyGraph::Recommends:
+            type = _("Recommends");
+            break;
+         default:
+            type = _("Depends");
+         }
+         lines.push_back(string(2 * i, ' ') + "<b>" + type + ":</b> " +
+                         path[i]->name());
+      }
+   } else {
+      lines.push_back(_("No manually installed package needs it anymore"));
+   }
+
+   vector<RPackage *> cascade;
+   pkg->_lister->getRemovalCascade(pkg, cascade);
+   if (!cascade.empty()) {
+      lines.push_back("");
+      lines.push_back(string("<b>") + _("Removing it also removes:") +
+                      "</b>");
+      for (unsigned int i = 0; i < cascade.size(); i++)
+         lines.push_back(cascade[i]->name());
+   }
+   return lines;
+}
+
 void RGPkgDetailsWindow::cbShowBigScreenshot(GtkWidget *box, 
                                              GdkEventButton *event, 
                                              void *data)
@@ -365,6 +417,9 @@ void RGPkgDetailsWindow::fillInValues(RGGtkBuilderWindow *me,
    // provides
    me->setTreeList("treeview_provides", pkg->provides());
 
+   // what keeps it installed
+   me->setTreeList("treeview_whyinst", formatWhyInstalled(pkg), true);
+
 
    // file list
 #ifndef HAVE_RPM
@@ -40,6 +40,7 @@ class RGPkgDetailsWindow : public RGGtkBuilderWindow {
    };
 
    static vector<string> formatDepInformation(vector<DepInformation> deps);
+   static vector<string> formatWhyInstalled(RPackage *pkg);
    static void cbDependsMenuChanged(GtkWidget *self, void *data);
    static void cbCloseClicked(GtkWidget *self, void *data);
    static void cbShowScreenshot(GtkWidget *button, void *data);
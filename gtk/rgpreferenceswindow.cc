@@ -539,7 +539,7 @@ void RGPreferencesWindow::readGeneral()
 #ifdef HAVE_RPM
    int UndoStackSize = 3;
 #else
-   int UndoStackSize = 20;
+   int UndoStackSize = 500;
 #endif
    gtk_spin_button_set_value(GTK_SPIN_BUTTON(_maxUndoE),
                              _config->FindI("Synaptic::undoStackSize",
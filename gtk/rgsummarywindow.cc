@@ -46,26 +46,18 @@ void RGSummaryWindow::buildTree(RGSummaryWindow *me)
    RPackageLister *lister = me->_lister;
    GtkTreeIter iter, iter_child;
 
-   vector<RPackage *> held;
-   vector<RPackage *> kept;
-   vector<RPackage *> essential;
-   vector<RPackage *> toInstall;
-   vector<RPackage *> toReInstall;
-   vector<RPackage *> toUpgrade;
-   vector<RPackage *> toRemove;
-   vector<RPackage *> toPurge;
-   vector<RPackage *> toDowngrade;
+   const RChangeSet &changes = lister->getChangeSet(true);
+   const vector<RPackage *> &held = changes.held;
+   const vector<RPackage *> &essential = changes.essential;
+   const vector<RPackage *> &toInstall = changes.toInstall;
+   const vector<RPackage *> &toReInstall = changes.toReInstall;
+   const vector<RPackage *> &toUpgrade = changes.toUpgrade;
+   const vector<RPackage *> &toRemove = changes.toRemove;
+   const vector<RPackage *> &toPurge = changes.toPurge;
+   const vector<RPackage *> &toDowngrade = changes.toDowngrade;
 #ifdef WITH_APT_AUTH
-   vector<string> notAuthenticated;
+   const vector<string> &notAuthenticated = changes.notAuthenticated;
 #endif
-   double sizeChange;
-
-   lister->getDetailedSummary(held, kept, essential, toInstall, toReInstall,
-			      toUpgrade,  toRemove, toPurge, toDowngrade, 
-#ifdef WITH_APT_AUTH
-			      notAuthenticated,
-#endif
-			      sizeChange);
 
 #ifdef WITH_APT_AUTH
    if(notAuthenticated.size() > 0) {
@@ -219,25 +211,14 @@ void RGSummaryWindow::buildLabel(RGSummaryWindow *me)
 
    info = GTK_WIDGET(gtk_builder_get_object(me->_builder, "label_details"));
 
-   vector<RPackage *> held;
-   vector<RPackage *> kept;
-   vector<RPackage *> essential;
-   vector<RPackage *> toInstall;
-   vector<RPackage *> toReInstall;
-   vector<RPackage *> toUpgrade;
-   vector<RPackage *> toRemove;
-   vector<RPackage *> toPurge;
-   vector<RPackage *> toDowngrade;
-   vector<string> notAuthenticated;
-   double sizeChange;
-
-   me->_lister->getDetailedSummary(held, kept, essential,
-				   toInstall,toReInstall,toUpgrade, 
-				   toRemove, toPurge, toDowngrade, 
-#ifdef WITH_APT_AUTH
-				   notAuthenticated,
-#endif
-				   sizeChange);
+   const RChangeSet &changes = me->_lister->getChangeSet();
+   const vector<RPackage *> &essential = changes.essential;
+   const vector<RPackage *> &toInstall = changes.toInstall;
+   const vector<RPackage *> &toReInstall = changes.toReInstall;
+   const vector<RPackage *> &toUpgrade = changes.toUpgrade;
+   const vector<RPackage *> &toRemove = changes.toRemove;
+   const vector<RPackage *> &toPurge = changes.toPurge;
+   const vector<RPackage *> &toDowngrade = changes.toDowngrade;
 
    for (vector<RPackage *>::const_iterator p = essential.begin();
         p != essential.end(); p++) {
@@ -388,9 +369,17 @@ RGSummaryWindow::RGSummaryWindow(RGWindow *wwin, RPackageLister *lister)
    GString *msg = g_string_new("");
    GString *msg_space = g_string_new("");
 
-   lister->getSummary(held, kept, essential,
-                      toInstall, toReInstall, toUpgrade, toRemove, 
-		      toDowngrade, unAuthenticated,sizeChange);
+   const RChangeSet &changes = lister->getChangeSet();
+   held = changes.held.size();
+   kept = changes.kept.size();
+   essential = changes.essential.size();
+   toInstall = changes.toInstall.size();
+   toReInstall = changes.toReInstall.size();
+   toUpgrade = changes.toUpgrade.size();
+   toRemove = changes.removeCount();
+   toDowngrade = changes.toDowngrade.size();
+   unAuthenticated = changes.unauthenticated;
+   sizeChange = changes.sizeChange;
    lister->getDownloadSummary(dlCount, dlSize);
 
 #if 0
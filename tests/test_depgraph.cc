@@ -0,0 +1,184 @@
+#include <apt-pkg/init.h>
+#include <iostream>
+#include <algorithm>
+#include <sys/time.h>
+
+#include "config.h"
+#include "rpackagelister.h"
+
+using namespace std;
+
+// the queries on a small graph with known answers first, then the
+// time of building the dependency graph of the cache and of the
+// queries on it, for the package given or the first automatically
+// installed one
+static double now()
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+enum {
+   App, Postfix, Exim, Doc, Lib, Tool, Unrelated, Other, Client, Suggester,
+   Top, Middle, Bottom, Count
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char *what)
+{
+   if (!ok) {
+      cerr << "FAILED: " << what << endl;
+      failures++;
+   }
+}
+
+static bool has(const vector<uint32_t> &ids, uint32_t id)
+{
+   return find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+static void addGroup(vector<RDependencyGraph::Group> &groups, uint32_t owner,
+                     uint8_t type, uint32_t member, int other = -1)
+{
+   RDependencyGraph::Group group;
+   group.owner = owner;
+   group.type = type;
+   group.members.push_back(member);
+   if (other >= 0)
+      group.members.push_back(other);
+   groups.push_back(group);
+}
+
+// the edges of the graph below, to check the links of a path
+static bool isEdge(const vector<RDependencyGraph::Group> &groups,
+                   uint32_t from, uint32_t to, uint8_t type)
+{
+   for (unsigned int i = 0; i < groups.size(); i++) {
+      if (groups[i].owner == from && groups[i].type == type &&
+          has(groups[i].members, to))
+         return true;
+   }
+   return false;
+}
+
+static void checkGraph()
+{
+   // App needs a mail transport agent, Postfix or Exim, and recommends
+   // Doc; Client needs Postfix itself; Suggester only recommends Lib,
+   // which Tool needs; Top needs Middle, which needs Bottom
+   vector<RDependencyGraph::Group> groups;
+   addGroup(groups, App, RDependencyGraph::Depends, Postfix, Exim);
+   addGroup(groups, App, RDependencyGraph::Recommends, Doc);
+   addGroup(groups, Tool, RDependencyGraph::Depends, Lib);
+   addGroup(groups, Unrelated, RDependencyGraph::Depends, Other);
+   addGroup(groups, Client, RDependencyGraph::PreDepends, Postfix);
+   addGroup(groups, Suggester, RDependencyGraph::Recommends, Lib);
+   addGroup(groups, Top, RDependencyGraph::Depends, Middle);
+   addGroup(groups, Middle, RDependencyGraph::Depends, Bottom);
+
+   RDependencyGraph graph;
+   graph.build(Count, vector<bool>(Count, true), groups);
+
+   vector<uint32_t> start, ids;
+   start.assign(1, App);
+   graph.closure(start, RDependencyGraph::All, false, ids);
+   check(ids.size() == 3 && has(ids, Postfix) && has(ids, Exim) &&
+         has(ids, Doc), "closure of App is Postfix, Exim and Doc");
+   check(!has(ids, App) && !has(ids, Lib) && !has(ids, Other),
+         "closure of App leaves out the rest");
+
+   start.assign(1, Lib);
+   graph.reverseClosure(start, RDependencyGraph::Hard, true, ids);
+   check(ids.size() == 1 && has(ids, Tool),
+         "reverse closure of Lib over Hard edges is Tool");
+   graph.reverseClosure(start, RDependencyGraph::All, true, ids);
+   check(has(ids, Suggester), "reverse closure over all edges has Suggester");
+
+   start.assign(1, Postfix);
+   graph.removalClosure(start, RDependencyGraph::Hard, ids);
+   check(ids.size() == 1 && has(ids, Client),
+         "removing Postfix takes Client, App still has Exim");
+   start.push_back(Exim);
+   graph.removalClosure(start, RDependencyGraph::Hard, ids);
+   check(ids.size() == 2 && has(ids, Client) && has(ids, App),
+         "removing both agents takes App as well");
+
+   vector<bool> from(Count, false);
+   from[Top] = true;
+   vector<uint8_t> types;
+   bool found = graph.shortestPath(from, Bottom, RDependencyGraph::All,
+                                   true, ids, types);
+   check(found && ids.size() == 3 && types.size() == 2 && ids[0] == Top &&
+         ids[2] == Bottom, "path from Top to Bottom");
+   for (unsigned int i = 0; found && i + 1 < ids.size(); i++)
+      check(i < types.size() && isEdge(groups, ids[i], ids[i + 1], types[i]),
+            "every link of the path is an edge");
+
+   from.assign(Count, false);
+   from[App] = true;
+   check(!graph.shortestPath(from, Doc, RDependencyGraph::Hard, true, ids,
+                             types), "no Hard path to what is recommended");
+}
+
+int main(int argc, char **argv)
+{
+   checkGraph();
+   if (failures > 0)
+      return 1;
+
+   pkgInitConfig(*_config);
+   pkgInitSystem(*_config, _system);
+
+   RPackageLister *lister = new RPackageLister();
+   lister->openCache();
+
+   double start = now();
+   RDependencyGraph *graph = lister->getDependencyGraph();
+   cerr << "build: " << now() - start << "s, " << graph->size()
+        << " packages, " << graph->edgeCount() << " edges" << endl;
+
+   RPackage *pkg = NULL;
+   if (argc > 1) {
+      pkg = lister->getPackage(argv[1]);
+   } else {
+      const vector<RPackage *> &packages = lister->getPackages();
+      for (unsigned int i = 0; i < packages.size() && pkg == NULL; i++) {
+         int flags = packages[i]->getFlags();
+         if ((flags & RPackage::FInstalled) && (flags & RPackage::FIsAuto))
+            pkg = packages[i];
+      }
+   }
+   if (pkg == NULL) {
+      cerr << "no package to ask about" << endl;
+      return 1;
+   }
+   cerr << "package: " << pkg->name() << endl;
+
+   vector<RPackage *> path;
+   vector<int> types;
+   start = now();
+   bool found = lister->getWhyInstalled(pkg, path, types);
+   cerr << "why installed: " << now() - start << "s" << endl;
+   for (unsigned int i = 0; found && i < path.size(); i++)
+      cerr << "  " << path[i]->name() << endl;
+
+   vector<RPackage *> result;
+   start = now();
+   lister->getPulledInBy(pkg, result);
+   cerr << "pulled in by: " << now() - start << "s, " << result.size()
+        << " manually installed packages" << endl;
+
+   start = now();
+   lister->getRemovalCascade(pkg, result);
+   cerr << "removal cascade: " << now() - start << "s, " << result.size()
+        << " packages" << endl;
+
+   start = now();
+   lister->getDependencyClosure(pkg, result);
+   cerr << "closure: " << now() - start << "s, " << result.size()
+        << " packages" << endl;
+
+   delete lister;
+}
@@ -0,0 +1,52 @@
+#include <apt-pkg/init.h>
+#include <iostream>
+#include <cstdlib>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "config.h"
+#include "rpackagelister.h"
+
+using namespace std;
+
+// time of opening the cache and opening it again, as done after every
+// update and commit, and the peak memory use; run it on the builds
+// to compare, with the same package cache
+static double now()
+{
+   struct timeval tv;
+   gettimeofday(&tv, NULL);
+   return tv.tv_sec + tv.tv_usec / 1000000.0;
+}
+
+int main(int argc, char **argv)
+{
+   pkgInitConfig(*_config);
+   pkgInitSystem(*_config, _system);
+
+   int reopens = argc > 1 ? atoi(argv[1]) : 5;
+
+   RPackageLister *lister = new RPackageLister();
+
+   double start = now();
+   lister->openCache();
+   cerr << "open: " << now() - start << "s, "
+        << lister->getPackages().size() << " packages" << endl;
+
+   double total = 0;
+   for (int i = 0; i < reopens; i++) {
+      start = now();
+      lister->openCache();
+      double t = now() - start;
+      total += t;
+      cerr << "reopen " << i + 1 << ": " << t << "s" << endl;
+   }
+   if (reopens > 0)
+      cerr << "reopen average: " << total / reopens << "s" << endl;
+
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+   cerr << "peak rss: " << usage.ru_maxrss << " kB" << endl;
+
+   delete lister;
+}
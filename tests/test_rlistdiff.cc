@@ -0,0 +1,136 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <ctime>
+
+#include "rlistdiff.h"
+
+using namespace std;
+
+// apply the diff the way a GtkTreeModel sees it: removals from the
+// last row on, inserts from the first row on, then the reorder
+static vector<unsigned int> apply(const vector<unsigned int> &oldList,
+                                  const vector<unsigned int> &newList,
+                                  const RListDiff &diff)
+{
+   vector<bool> gone(oldList.size(), false);
+   for (unsigned int i = 0; i < diff.removed.size(); i++) {
+      if (i > 0 && diff.removed[i] >= diff.removed[i-1])
+         return vector<unsigned int>();
+      gone[diff.removed[i]] = true;
+   }
+   vector<unsigned int> kept;
+   for (unsigned int i = 0; i < oldList.size(); i++)
+      if (!gone[i])
+         kept.push_back(oldList[i]);
+
+   // inserting at ascending rows one after the other
+   vector<unsigned int> list;
+   unsigned int k = 0, j = 0;
+   for (unsigned int row = 0; row < kept.size() + diff.inserted.size(); row++) {
+      if (j < diff.inserted.size() && diff.inserted[j] == (int)row)
+         list.push_back(newList[diff.inserted[j++]]);
+      else if (k < kept.size())
+         list.push_back(kept[k++]);
+   }
+
+   if (diff.reordered) {
+      vector<unsigned int> reordered;
+      for (unsigned int i = 0; i < diff.order.size(); i++)
+         reordered.push_back(list[diff.order[i]]);
+      list = reordered;
+   }
+   return list;
+}
+
+static bool check(const char *name, const vector<unsigned int> &oldList,
+                  const vector<unsigned int> &newList, unsigned int maxId,
+                  const vector<bool> &dirty, bool reordered)
+{
+   RListDiff diff;
+
+   unsigned long now = clock();
+   diff.diff(oldList, newList, maxId, &dirty);
+   cerr << name << ": " << float(clock()-now)/CLOCKS_PER_SEC << "s, "
+        << diff.removed.size() << " removed, "
+        << diff.inserted.size() << " inserted, "
+        << diff.changed.size() << " changed" << endl;
+
+   // minimal: every package is kept unless it really went away
+   vector<bool> inOld(maxId, false), inNew(maxId, false);
+   for (unsigned int i = 0; i < oldList.size(); i++)
+      inOld[oldList[i]] = true;
+   for (unsigned int i = 0; i < newList.size(); i++)
+      inNew[newList[i]] = true;
+   unsigned int gone = 0, added = 0, changed = 0;
+   for (unsigned int id = 0; id < maxId; id++) {
+      if (inOld[id] && !inNew[id])
+         gone++;
+      if (!inOld[id] && inNew[id])
+         added++;
+      if (inOld[id] && inNew[id] && dirty[id])
+         changed++;
+   }
+
+   if (diff.removed.size() != gone || diff.inserted.size() != added ||
+       diff.changed.size() != changed || diff.reordered != reordered) {
+      cerr << name << ": FAILED, diff is not minimal" << endl;
+      return false;
+   }
+   if (apply(oldList, newList, diff) != newList) {
+      cerr << name << ": FAILED, applying the diff gives a different list"
+           << endl;
+      return false;
+   }
+   return true;
+}
+
+int main(int argc, char **argv)
+{
+   const unsigned int size = 100000;
+   const unsigned int maxId = 2 * size;
+   bool ok = true;
+
+   srand(42);
+
+   // two sorted views of 100k packages sharing about half of them
+   vector<unsigned int> oldList, newList;
+   for (unsigned int id = 0; id < maxId; id++) {
+      int r = rand() % 4;
+      if (r == 0 || r == 1)
+         oldList.push_back(id);
+      if (r == 1 || r == 2)
+         newList.push_back(id);
+   }
+   oldList.resize(min<size_t>(oldList.size(), size));
+   newList.resize(min<size_t>(newList.size(), size));
+
+   vector<bool> dirty(maxId, false);
+   for (unsigned int i = 0; i < 1000; i++)
+      dirty[rand() % maxId] = true;
+
+   ok &= check("sorted", oldList, newList, maxId, dirty, false);
+   ok &= check("identical", oldList, oldList, maxId, dirty, false);
+   ok &= check("emptied", oldList, vector<unsigned int>(), maxId, dirty, false);
+   ok &= check("filled", vector<unsigned int>(), newList, maxId, dirty, false);
+
+   // a resort of the same view
+   vector<unsigned int> shuffled = oldList;
+   for (unsigned int i = shuffled.size() - 1; i > 0; i--)
+      swap(shuffled[i], shuffled[rand() % (i + 1)]);
+   ok &= check("resorted", oldList, shuffled, maxId, dirty, true);
+
+   // a resort together with packages coming and going
+   vector<unsigned int> mixed = newList;
+   for (unsigned int i = mixed.size() - 1; i > 0; i--)
+      swap(mixed[i], mixed[rand() % (i + 1)]);
+   ok &= check("resorted and filtered", oldList, mixed, maxId, dirty, true);
+
+   // a package moved to another position after a change
+   vector<unsigned int> moved = oldList;
+   rotate(moved.begin() + 10, moved.begin() + 11, moved.end() - 10);
+   ok &= check("moved", oldList, moved, maxId, dirty, true);
+
+   return ok ? 0 : 1;
+}
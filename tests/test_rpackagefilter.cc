@@ -20,7 +20,7 @@ int main(int argc, char **argv)
 
    RFilter *filter, *filter_copy;
    vector<RPackage *> pkgs;
-   RPackageViewFilter filter_view(pkgs);
+   RPackageViewFilter filter_view(pkgs, pkgs);
    for(int i=0; i < filter_view.nrOfFilters(); i++) {
       filter = filter_view.findFilter(i);
       std::cerr << "orig: " << filter->getName()